@@ -53,7 +53,7 @@
     ASSERT(                                                                    \
         value, IS_NUMBER(element_at(value, index)),                            \
         "operator '%s' can only operate on numbers. Found value of type %s.",  \
-        caller, get_type(value))                                               \
+        caller, get_type(element_at(value, index)))                            \
   } while (0)
 
 /*
@@ -69,6 +69,36 @@
            "a list.")                                                          \
   } while (0)
 
+/*
+ * src/assert.h:ASSERT_IS_VECTOR
+ * buildyourownlisp.com correspondence: none
+ *
+ * Assert that the Value is of type Vector.
+ *
+ */
+#define ASSERT_IS_VECTOR(value, index, caller)                                 \
+  do {                                                                         \
+    ASSERT(value, IS_VECTOR(element_at(value, index)), BASE_FORMAT, caller,    \
+           "a vector.")                                                        \
+  } while (0)
+
+/*
+ * src/assert.h:ASSERT_IS_INDEX
+ * buildyourownlisp.com correspondence: none
+ *
+ * Assert that the Value is a Number that can count elements of a list: a
+ * nonnegative integer.
+ *
+ */
+#define ASSERT_IS_INDEX(value, index, caller)                                  \
+  do {                                                                         \
+    Value *number = element_at(value, index);                                  \
+    ASSERT(value,                                                              \
+           IS_NUMBER(number) && number_of(number) >= 0 &&                      \
+               number_of(number) == floor(number_of(number)),                  \
+           BASE_FORMAT, caller, "a nonnegative integer.")                      \
+  } while (0)
+
 /*
  * src/assert.h:ASSERT_IS_SYMBOL
  * buildyourownlisp.com correspondence: LASSERT_TYPE(LVAL_SYM)
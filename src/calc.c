@@ -15,119 +15,142 @@ static bool is_integer(double x) {
   return difference > -epsilon && difference < epsilon;
 }
 
+/* Define a kernel, which applies an operator to `numbers[0]` to
+`numbers[count - 1]` (at least one of them) and returns the result, or an error
+Value */
+typedef Value *(*Kernel)(Value **numbers, size_t count);
+
 /*
- * src/calc.c:numeric_error
+ * src/calc.c:FOLD_KERNEL
  * buildyourownlisp.com correspondence: contained within builtin_op
  *
- * Replace numeric values that are invalid for a given operation with an error
- * value.
+ * Define a kernel for an operator that never fails, which combines the numbers
+ * from left to right: `x` holds the result so far, and `y` the next number.
  *
  */
-static Value *numeric_error(Value *x, Value *y, char *format, ...) {
-  delete_value(x);
-  delete_value(y);
+#define FOLD_KERNEL(name, expression)                                          \
+  static Value *name(Value **numbers, size_t count) {                          \
+    double x = number_of(numbers[0]);                                          \
+    for (size_t index = 1; index < count; index++) {                           \
+      double y = number_of(numbers[index]);                                    \
+      x = expression;                                                          \
+    }                                                                          \
+    return make_number(x);                                                     \
+  }
+
+FOLD_KERNEL(add_numbers, x + y)
+FOLD_KERNEL(multiply_numbers, x * y)
+FOLD_KERNEL(min_numbers, fmin(x, y))
+FOLD_KERNEL(max_numbers, fmax(x, y))
 
-  va_list pieces;
-  va_start(pieces, format);
-  Value *error = va_list_make_error(format, pieces);
-  va_end(pieces);
+#undef FOLD_KERNEL
 
-  return error;
+// Subtract numbers from the first one, or negate a single number
+static Value *subtract_numbers(Value **numbers, size_t count) {
+  double x = number_of(numbers[0]);
+  if (count == 1) {
+    return make_number(-x);
+  }
+  for (size_t index = 1; index < count; index++) {
+    x -= number_of(numbers[index]);
+  }
+  return make_number(x);
+}
+
+// Divide the first number by the others, none of which may be zero
+static Value *divide_numbers(Value **numbers, size_t count) {
+  double x = number_of(numbers[0]);
+  for (size_t index = 1; index < count; index++) {
+    double y = number_of(numbers[index]);
+    if (y == 0) {
+      return make_error("cannot divide by zero.");
+    }
+    x /= y;
+  }
+  return make_number(x);
 }
 
 /*
- * src/calc.c:calculate
- * buildyourownlisp.com correspondence: builtin_op
+ * src/calc.c:modulo_numbers
+ * buildyourownlisp.com correspondence: contained within builtin_op
  *
- * Calculate numerical expressions. All built-in operations delegate to this
- * big function, which in turn does a switch-like series of conditionals; in
- * between, there is type checking and handling of the edge case of unary
- * negation.
+ * Take the remainder of dividing the first number by the next one, then that
+ * by the one after, and so on. Since the modulo is the remainder of a
+ * division, no operand after the first may be zero; and the operation is only
+ * performed on integers.
  *
  */
-static Value *calculate(Value *value, char *op) {
-  /* Ensure all arguments are numbers */
-  for (size_t index = 0; index < count(value); index++) {
-    ASSERT_IS_NUMBER(value, index, op);
-  }
-
-  Value *result = pop(value);
-
-#define IS_OP(str) (strcmp(op, str) == 0)
+static Value *modulo_numbers(Value **numbers, size_t count) {
+  double x = number_of(numbers[0]);
+  for (size_t index = 1; index < count; index++) {
+    double y = number_of(numbers[index]);
+    if (y == 0) {
+      return make_error("modulus cannot be zero.");
+    }
+    if (!is_integer(x) || !is_integer(y)) {
+      char *x_string = stringify(make_number(x));
+      char *y_string = stringify(numbers[index]);
+      Value *error = make_error(
+          "operands of modulo must be integers, found %s and %s.", x_string,
+          y_string);
+      free(x_string);
+      free(y_string);
+      return error;
+    }
 
-  /* Check for unary negation; the count is zero because the number
-  has been popped a few lines above */
-  if (IS_OP("-") && count(value) == 0) {
-    result->data.number = -result->data.number;
+    long remainder = (long)x % (long)y;
+    if (remainder < 0) {
+      remainder += (long)y;
+    }
+    x = (double)remainder;
   }
+  return make_number(x);
+}
 
-  /* Since we're using Polish Notation, each operation can take any number of
-  operands, hence a while loop */
-  while (count(value) > 0) {
-    /* Pop the next element */
-    Value *operand = pop(value);
-
-    /* Check which operation is being performed and execute it */
-    if (IS_OP("+")) {
-      result->data.number += operand->data.number;
-    } else if (IS_OP("-")) {
-      result->data.number -= operand->data.number;
-    } else if (IS_OP("*")) {
-      result->data.number *= operand->data.number;
-    } else if (IS_OP("/")) {
-      if (operand->data.number == 0) {
-        result = numeric_error(result, operand, "cannot divide by zero.");
-        break;
-      }
-      result->data.number /= operand->data.number;
-    } else if (IS_OP("%")) {
-      /* Since the modulo is the remainder of a division, its second operand
-      cannot be zero */
-      if (operand->data.number == 0) {
-        result = numeric_error(result, operand, "modulus cannot be zero.");
-        break;
-      }
-      if (is_integer(result->data.number) && is_integer(operand->data.number)) {
-        /* We perform the operation only on integers */
-        long int_result = (long)result->data.number;
-        long int_operand = (long)operand->data.number;
-        int_result %= int_operand;
-        if (int_result < 0) {
-          int_result += int_operand;
-        }
-        result->data.number = (double)int_result;
-      } else {
-        char *x = stringify(result);
-        char *y = stringify(operand);
-        result = numeric_error(
-            result, operand,
-            "operands of modulo must be integers, found %s and %s.", x, y);
-        free(x);
-        free(y);
-        break;
-      }
-    } else if (IS_OP("^")) {
-      /* No raising zero to a negative power */
-      if (result->data.number == 0 && operand->data.number < 0) {
-        char *x = stringify(operand);
-        result = numeric_error(
-            result, operand,
-            "cannot raise 0 to negative power %s (requires dividing by 0).", x);
-        free(x);
-        break;
-      }
-      result->data.number = pow(result->data.number, operand->data.number);
-    } else if (IS_OP("max")) {
-      result->data.number = fmax(result->data.number, operand->data.number);
-    } else if (IS_OP("min")) {
-      result->data.number = fmin(result->data.number, operand->data.number);
+// Raise the first number to the power of the next one, and so on
+static Value *raise_numbers(Value **numbers, size_t count) {
+  double x = number_of(numbers[0]);
+  for (size_t index = 1; index < count; index++) {
+    double y = number_of(numbers[index]);
+    /* No raising zero to a negative power */
+    if (x == 0 && y < 0) {
+      char *y_string = stringify(numbers[index]);
+      Value *error = make_error(
+          "cannot raise 0 to negative power %s (requires dividing by 0).",
+          y_string);
+      free(y_string);
+      return error;
     }
-
-    delete_value(operand);
+    x = pow(x, y);
   }
+  return make_number(x);
+}
 
-#undef IS_OP
+/*
+ * src/calc.c:calculate
+ * buildyourownlisp.com correspondence: builtin_op
+ *
+ * Calculate numerical expressions. Every built-in operation checks that its
+ * arguments are all numbers, which are immediate, and then hands them over to
+ * the kernel for its operator all at once; `op` is only used in error
+ * messages. Operators that also work on vectors have a second kernel, used
+ * when any of the arguments is one (see vector.h).
+ *
+ */
+static Value *calculate(Value *value, char *op, Kernel kernel,
+                        Kernel vector_kernel) {
+  /* Ensure all arguments are numbers, or vectors where those are allowed */
+  bool has_vectors = false;
+  for (size_t index = 0; index < count(value); index++) {
+    if (vector_kernel && IS_VECTOR(element_at(value, index))) {
+      has_vectors = true;
+      continue;
+    }
+    ASSERT_IS_NUMBER(value, index, op);
+  }
 
+  Value *result = (has_vectors ? vector_kernel : kernel)(
+      value->data.sexpr.cell, count(value));
   delete_value(value);
   return result;
 }
@@ -140,7 +163,7 @@ static Value *calculate(Value *value, char *op) {
  *
  */
 Value *builtin_add(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "+");
+  return calculate(value, "+", add_numbers, add_vectors);
 }
 
 /*
@@ -152,7 +175,7 @@ Value *builtin_add(__attribute__((unused)) Env *env, Value *value) {
  *
  */
 Value *builtin_subtract(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "-");
+  return calculate(value, "-", subtract_numbers, subtract_vectors);
 }
 
 /*
@@ -163,7 +186,7 @@ Value *builtin_subtract(__attribute__((unused)) Env *env, Value *value) {
  *
  */
 Value *builtin_multiply(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "*");
+  return calculate(value, "*", multiply_numbers, multiply_vectors);
 }
 
 /*
@@ -174,7 +197,7 @@ Value *builtin_multiply(__attribute__((unused)) Env *env, Value *value) {
  *
  */
 Value *builtin_divide(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "/");
+  return calculate(value, "/", divide_numbers, divide_vectors);
 }
 
 /*
@@ -187,7 +210,7 @@ Value *builtin_divide(__attribute__((unused)) Env *env, Value *value) {
  *
  */
 Value *builtin_modulo(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "%");
+  return calculate(value, "%", modulo_numbers, NULL);
 }
 
 /*
@@ -198,7 +221,7 @@ Value *builtin_modulo(__attribute__((unused)) Env *env, Value *value) {
  *
  */
 Value *builtin_exp(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "^");
+  return calculate(value, "^", raise_numbers, NULL);
 }
 
 /*
@@ -209,7 +232,7 @@ Value *builtin_exp(__attribute__((unused)) Env *env, Value *value) {
  *
  */
 Value *builtin_min(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "min");
+  return calculate(value, "min", min_numbers, min_vectors);
 }
 
 /*
@@ -220,5 +243,5 @@ Value *builtin_min(__attribute__((unused)) Env *env, Value *value) {
  *
  */
 Value *builtin_max(__attribute__((unused)) Env *env, Value *value) {
-  return calculate(value, "max");
+  return calculate(value, "max", max_numbers, max_vectors);
 }
@@ -14,6 +14,7 @@
 
 #include "assert.h"
 #include "value.h"
+#include "vector.h"
 
 Value *builtin_add(Env *env, Value *value);
 Value *builtin_subtract(Env *env, Value *value);
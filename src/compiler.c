@@ -0,0 +1,188 @@
+#include "compiler.h"
+
+#include "env.h"
+
+/*
+ * src/compiler.c:make_code
+ * buildyourownlisp.com correspondence: none
+ *
+ * Create an empty piece of Code.
+ *
+ */
+static Code *make_code(void) {
+  Code *code = malloc(sizeof(Code));
+  code->references = 1;
+  code->count = 0;
+  code->capacity = 0;
+  code->instructions = NULL;
+  return code;
+}
+
+/*
+ * src/compiler.c:emit
+ * buildyourownlisp.com correspondence: none
+ *
+ * Append an instruction to a piece of Code, returning it so that its operand
+ * may be filled in.
+ *
+ */
+static Instruction *emit(Code *code, Opcode opcode, size_t count) {
+  if (code->count == code->capacity) {
+    code->capacity = code->capacity ? code->capacity * 2 : 8;
+    code->instructions =
+        realloc(code->instructions, sizeof(Instruction) * code->capacity);
+  }
+
+  Instruction *instruction = &code->instructions[code->count++];
+  instruction->opcode = opcode;
+  instruction->count = (uint32_t)count;
+  instruction->operand.value = NULL;
+  return instruction;
+}
+
+/*
+ * src/compiler.c:compile_atom
+ * buildyourownlisp.com correspondence: lval_eval
+ *
+ * Compile the instruction that pushes the value of an expression which is not
+ * a nonempty S-expression.
+ *
+ */
+static void compile_atom(Code *code, Value *value) {
+  /* Variable access; all other Value types remain the same, including the
+  empty expression, (), which evaluates to itself */
+  Opcode opcode = IS_SYMBOL(value) ? OP_LOAD : OP_PUSH;
+  emit(code, opcode, 0)->operand.value = value;
+}
+
+/*
+ * src/compiler.c:compile_apply
+ * buildyourownlisp.com correspondence: lval_eval_sexpr
+ *
+ * Compile the instruction that applies the first element of a list, once all
+ * of its elements are on the stack, to the others.
+ *
+ */
+static void compile_apply(Code *code, Value *list) {
+  size_t length = count(list);
+  Value *first = element_at(list, 0);
+  Builtin builtin =
+      IS_SYMBOL(first) ? find_builtin(first->data.symbol.name) : NULL;
+
+  /* A builtin alone is not called, so it needs no special treatment */
+  if (builtin && length > 1) {
+    emit(code, OP_BUILTIN, length)->operand.builtin = builtin;
+  } else {
+    emit(code, OP_APPLY, length);
+  }
+}
+
+/* A list being compiled, and how many of its elements have been */
+typedef struct Pending {
+  Value *list;
+  size_t index;
+} Pending;
+
+/*
+ * src/compiler.c:compile_elements
+ * buildyourownlisp.com correspondence: lval_eval_sexpr
+ *
+ * Compile the (at least one) elements of a list as an S-expression: each
+ * element is evaluated in order, then the first one is applied to the others.
+ * Nested S-expressions are compiled using an explicit stack rather than by
+ * recursion, so there is no limit to how deeply they may be nested.
+ *
+ */
+static void compile_elements(Code *code, Value *list) {
+  Pending *pending = malloc(sizeof(Pending) * 16);
+  size_t capacity = 16;
+  size_t depth = 0;
+
+  pending[depth++] = (Pending){list, 0};
+  while (depth > 0) {
+    Pending *top = &pending[depth - 1];
+    if (top->index == count(top->list)) {
+      compile_apply(code, top->list);
+      depth--;
+      continue;
+    }
+
+    Value *element = element_at(top->list, top->index++);
+    if (!IS_SEXPR(element) || count(element) == 0) {
+      compile_atom(code, element);
+      continue;
+    }
+
+    if (depth == capacity) {
+      capacity *= 2;
+      pending = realloc(pending, sizeof(Pending) * capacity);
+    }
+    pending[depth++] = (Pending){element, 0};
+  }
+
+  free(pending);
+}
+
+/*
+ * src/compiler.c:compile
+ * buildyourownlisp.com correspondence: none
+ *
+ * Compile a Lye expression.
+ *
+ */
+Code *compile(Value *value) {
+  Code *code = make_code();
+  if (IS_SEXPR(value) && count(value) > 0) {
+    compile_elements(code, value);
+  } else {
+    compile_atom(code, value);
+  }
+  emit(code, OP_RETURN, 0);
+  return code;
+}
+
+/*
+ * src/compiler.c:compile_body
+ * buildyourownlisp.com correspondence: none
+ *
+ * Compile the body of a lambda, a Q-expression which is evaluated as if it
+ * were an S-expression.
+ *
+ */
+Code *compile_body(Value *body) {
+  Code *code = make_code();
+  if (count(body) > 0) {
+    compile_elements(code, body);
+  } else {
+    emit(code, OP_EMPTY, 0);
+  }
+  emit(code, OP_RETURN, 0);
+  return code;
+}
+
+/*
+ * src/compiler.c:copy_code
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return a new reference to a piece of Code.
+ *
+ */
+Code *copy_code(Code *code) {
+  code->references++;
+  return code;
+}
+
+/*
+ * src/compiler.c:delete_code
+ * buildyourownlisp.com correspondence: none
+ *
+ * Drop a reference to a piece of Code, freeing it when it was the last one.
+ *
+ */
+void delete_code(Code *code) {
+  if (--code->references > 0) {
+    return;
+  }
+  free(code->instructions);
+  free(code);
+}
@@ -0,0 +1,60 @@
+/*
+ * src/compiler.h
+ *
+ * Define the bytecode that the virtual machine (see vm.h) runs, and expose
+ * functions to compile Lye expressions into it. A lambda's body is compiled
+ * once, when the lambda is created, and run as many times as it is called.
+ *
+ * Code does not own the Values it refers to: they are borrowed from the
+ * expression it was compiled from, which must outlive it.
+ *
+ */
+#ifndef lye_compiler_h
+#define lye_compiler_h
+
+#include <stdint.h>
+
+#include "value.h"
+
+/* Enumerate the instructions of the virtual machine */
+typedef enum {
+  /* Push a constant Value */
+  OP_PUSH,
+  /* Push a new, empty S-expression */
+  OP_EMPTY,
+  /* Push the value of a Symbol, or stop with an error if it is unbound */
+  OP_LOAD,
+  /* Evaluate an S-expression whose `count` elements are on the stack */
+  OP_APPLY,
+  /* Same as OP_APPLY, but the S-expression starts with the name of a builtin,
+  which is called directly if the name still refers to it */
+  OP_BUILTIN,
+  /* Finish the current Code, returning the Value on top of the stack */
+  OP_RETURN
+} Opcode;
+
+/* Define a single instruction */
+typedef struct Instruction {
+  uint32_t opcode;
+  uint32_t count;
+  union {
+    Value *value;
+    Builtin builtin;
+  } operand;
+} Instruction;
+
+/* Define a compiled expression. It may be shared by many copies of a lambda,
+so it is reference counted */
+typedef struct Code {
+  size_t references;
+  size_t count;
+  size_t capacity;
+  Instruction *instructions;
+} Code;
+
+Code *compile(Value *value);
+Code *compile_body(Value *body);
+Code *copy_code(Code *code);
+void delete_code(Code *code);
+
+#endif
@@ -1,10 +1,21 @@
 #include "env.h"
 
-#define BUILTINS_COUNT 21
+#include "gc.h"
+#include "symbol.h"
+
+#define BUILTINS_COUNT 28
 char builtin_names[BUILTINS_COUNT][10] = {
-    "def",  "=",    "\\",   "print-env", "list",    "eval", "head",
-    "tail", "join", "cons", "length",    "reverse", "init", "+",
-    "-",    "*",    "/",    "^",         "%",       "min",  "max"};
+    "def",       "=",       "\\",    "print-env", "list",   "eval",
+    "head",      "tail",    "join", "cons",      "length", "reverse",
+    "init",      "take",    "drop", "slice",     "+",      "-",
+    "*",         "/",       "^",    "%",         "min",    "max",
+    "to-vector", "to-list", "sum",  "dot"};
+
+/* The global Env, which is the one builtins are registered in */
+static Env *global_env = NULL;
+
+/* The name of `quit`, which may not be redefined either */
+static Symbol quit_name = NULL;
 
 // ===========================
 // Constructors and destructor
@@ -21,9 +32,10 @@ Env *make_env() {
   Env *env = malloc(sizeof(Env));
   env->parent = NULL;
   env->count = 0;
-  env->keys = NULL;
-  env->values = NULL;
-  env->is_builtin = NULL;
+  env->capacity = 0;
+  env->entries = NULL;
+  env->index_capacity = 0;
+  env->index = NULL;
   return env;
 }
 
@@ -32,7 +44,7 @@ Env *make_env() {
  * buildyourownlisp.com correspondence: lenv_copy
  *
  * Copy an existing Environment. Useful when copying Values that have Envs as
- * properties.
+ * properties. The new Env holds references to the same Values as the old one.
  *
  */
 Env *copy_env(Env const *old) {
@@ -40,14 +52,19 @@ Env *copy_env(Env const *old) {
 
   new->parent = old->parent;
   new->count = old->count;
-  new->keys = malloc(sizeof(Symbol) * new->count);
-  new->values = malloc(sizeof(Value *) * new->count);
-  new->is_builtin = malloc(sizeof(bool) * new->count);
-
+  new->capacity = old->count;
+  new->entries = malloc(sizeof(EnvEntry) * new->capacity);
   for (size_t index = 0; index < old->count; index++) {
-    new->keys[index] = malloc(strlen(old->keys[index]) + 1);
-    strcpy(new->keys[index], old->keys[index]);
-    new->values[index] = copy_value(old->values[index]);
+    new->entries[index] = old->entries[index];
+    copy_value(new->entries[index].value);
+  }
+
+  /* Entries keep their positions, so the index can be copied as it is */
+  new->index_capacity = old->index_capacity;
+  new->index = NULL;
+  if (old->index) {
+    new->index = malloc(sizeof(size_t) * new->index_capacity);
+    memcpy(new->index, old->index, sizeof(size_t) * new->index_capacity);
   }
 
   return new;
@@ -62,15 +79,89 @@ Env *copy_env(Env const *old) {
  */
 void delete_env(Env *env) {
   for (size_t index = 0; index < env->count; index++) {
-    free(env->keys[index]);
-    delete_value(env->values[index]);
+    delete_value(env->entries[index].value);
   }
-  free(env->keys);
-  free(env->values);
-  free(env->is_builtin);
+  destroy_env(env);
+}
+
+/*
+ * src/env.c:destroy_env
+ * buildyourownlisp.com correspondence: none
+ *
+ * Release the memory used by an Env itself, without dropping its references
+ * to the Values stored in it; whoever calls this deals with those.
+ *
+ */
+void destroy_env(Env *env) {
+  free(env->entries);
+  free(env->index);
   free(env);
 }
 
+// =====
+// Index
+// =====
+
+/*
+ * src/env.c:find_slot
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the slot of the index that holds the given key, or the empty slot
+ * where it would go. Must only be called on an Env that has an index.
+ *
+ */
+static size_t find_slot(Env *env, Symbol key) {
+  size_t mask = env->index_capacity - 1;
+  size_t slot = symbol_info(key)->hash & mask;
+  while (env->index[slot] && env->entries[env->index[slot] - 1].key != key) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/*
+ * src/env.c:rebuild_index
+ * buildyourownlisp.com correspondence: none
+ *
+ * Make a new index big enough for the Env's entries, and fill it in.
+ *
+ */
+static void rebuild_index(Env *env) {
+  free(env->index);
+  env->index_capacity = env->index_capacity ? env->index_capacity : 4;
+  while (env->index_capacity < 2 * env->count) {
+    env->index_capacity *= 2;
+  }
+  env->index = calloc(env->index_capacity, sizeof(size_t));
+
+  for (size_t position = 0; position < env->count; position++) {
+    env->index[find_slot(env, env->entries[position].key)] = position + 1;
+  }
+}
+
+/*
+ * src/env.c:find_entry
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the entry with the given key in the given Env only (not its
+ * parents), or NULL if there is none.
+ *
+ */
+static EnvEntry *find_entry(Env *env, Symbol key) {
+  /* Symbols are interned, so matching names are the same pointer */
+  if (env->index == NULL) {
+    for (size_t index = 0; index < env->count; index++) {
+      if (env->entries[index].key == key) {
+        return &env->entries[index];
+      }
+    }
+    return NULL;
+  }
+
+  size_t position = env->index[find_slot(env, key)];
+  return position ? &env->entries[position - 1] : NULL;
+}
+
 // ==================
 // Store and retrieve
 // ==================
@@ -79,7 +170,14 @@ void delete_env(Env *env) {
  * src/env.c:get_value
  * buildyourownlisp.com correspondence: lenv_get
  *
- * Return the value associated with the given key in the given Env.
+ * Return the value associated with the given key in the given Env. Two
+ * shortcuts avoid searching the Envs one by one in the common cases:
+ * - parameters of a lambda, evaluated in its body, know their position in the
+ *   lambda's Env (see `resolve_params`);
+ * - Symbols that were never bound outside the global Env can only be found
+ *   there, and know their position in it.
+ * Both are checked before being relied upon, so a stale hint only costs the
+ * full search.
  *
  */
 Value *get_value(Env *env, Value *key) {
@@ -88,22 +186,27 @@ Value *get_value(Env *env, Value *key) {
     exit(EX_SOFTWARE);
   }
 
-  /* Iterate over all items in the environment */
-  for (size_t index = 0; index < env->count; index++) {
-    /* Check if the stored string matches the symbol string */
-    if (strcmp(env->keys[index], key->data.symbol) == 0) {
-      /* If it does, return a copy of the value */
-      return copy_value(env->values[index]);
-    }
+  Symbol name = key->data.symbol.name;
+  size_t slot = key->data.symbol.slot;
+  if (slot && slot <= env->count && env->entries[slot - 1].key == name) {
+    return copy_value(env->entries[slot - 1].value);
   }
 
-  /* Check the parent environment. If no matching key is found all the way up
-   * to the root environment, return an error */
-  if (env->parent) {
-    return get_value(env->parent, key);
+  SymbolInfo *info = symbol_info(name);
+  if (!info->bound_locally && info->global_slot) {
+    return copy_value(global_env->entries[info->global_slot - 1].value);
   }
 
-  return make_error("unbound symbol '%s'.", key->data.symbol);
+  /* Look in each environment up to the root, and return a copy (that is, a
+  new reference) of the first value found */
+  for (; env; env = env->parent) {
+    EnvEntry *entry = find_entry(env, name);
+    if (entry) {
+      return copy_value(entry->value);
+    }
+  }
+
+  return make_error("unbound symbol '%s'.", name);
 }
 
 /*
@@ -111,7 +214,8 @@ Value *get_value(Env *env, Value *key) {
  * buildyourownlisp.com correspondence: lenv_put
  *
  * Insert a value into the given Environment at the corresponding key, updating
- * it if already there.
+ * it if already there. The caller keeps its own reference to `value`, and gets
+ * a new one back (or an error).
  *
  */
 Value *put_local_value(Env *env, Value *key, Value *value, bool is_builtin) {
@@ -120,41 +224,53 @@ Value *put_local_value(Env *env, Value *key, Value *value, bool is_builtin) {
     exit(EX_SOFTWARE);
   }
 
-  Value *value_copy = copy_value(value);
-
-  for (size_t index = 0; index < env->count; index++) {
-    /* First, check if the key is already present */
-    if (strcmp(env->keys[index], key->data.symbol) == 0) {
-      /* If it is... */
-      if (env->is_builtin[index] || strcmp(key->data.symbol, "quit") == 0) {
-        /* And it is not a builtin... */
-        delete_value(value);
-        delete_value(value_copy);
-        return make_error("cannot redefine builtin function %s.",
-                          key->data.symbol);
-      } else {
-        /* Substitute the provided one */
-        env->values[index] = value_copy;
-        env->is_builtin[index] = is_builtin;
-        return value;
-      }
+  /* First, check if the key is already present */
+  Symbol name = key->data.symbol.name;
+  EnvEntry *entry = find_entry(env, name);
+  if (entry) {
+    /* If it is a builtin, refuse to change it */
+    if (entry->is_builtin || name == quit_name) {
+      return make_error("cannot redefine builtin function %s.", name);
     }
+    /* Otherwise substitute the provided one, letting go of the old one. The
+    garbage collector must hear about it, in case it is in the middle of
+    marking */
+    shade_value(entry->value);
+    delete_value(entry->value);
+    entry->value = copy_value(value);
+    entry->is_builtin = is_builtin;
+    return copy_value(value);
   }
 
-  /* If the key is not found, make space for the new key-value pair */
-  env->count++;
-  env->keys = realloc(env->keys, sizeof(Symbol) * env->count);
-  env->values = realloc(env->values, sizeof(Value *) * env->count);
-  env->is_builtin = realloc(env->is_builtin, sizeof(bool) * env->count);
+  /* If the key is not found, make space for the new entry */
+  if (env->count == env->capacity) {
+    env->capacity = env->capacity ? env->capacity * 2 : 4;
+    env->entries = realloc(env->entries, sizeof(EnvEntry) * env->capacity);
+  }
 
   /* Insert the new key and value */
-  env->keys[env->count - 1] = malloc(strlen(key->data.symbol) + 1);
-  strcpy(env->keys[env->count - 1], key->data.symbol);
-  env->values[env->count - 1] = value_copy;
-  env->is_builtin[env->count - 1] = is_builtin;
+  entry = &env->entries[env->count++];
+  entry->key = name;
+  entry->value = copy_value(value);
+  entry->is_builtin = is_builtin;
+
+  /* Keep the shortcuts of `get_value` up to date. Entries never move, so a
+  global slot stays valid once known */
+  if (env == global_env) {
+    symbol_info(name)->global_slot = env->count;
+  } else {
+    symbol_info(name)->bound_locally = true;
+  }
+
+  /* Index it, if the Env is big enough to have an index */
+  if (2 * env->count > env->index_capacity && env->count > ENV_INDEX_MIN) {
+    rebuild_index(env);
+  } else if (env->index) {
+    env->index[find_slot(env, entry->key)] = env->count;
+  }
 
   /* Return the inserted Value */
-  return value;
+  return copy_value(value);
 }
 
 /*
@@ -172,6 +288,27 @@ Value *put_global_value(Env *env, Value *key, Value *value, bool is_builtin) {
   return put_local_value(env, key, value, is_builtin);
 }
 
+/*
+ * src/env.c:shadows_env
+ * buildyourownlisp.com correspondence: none
+ *
+ * Check whether every key of `other` is also bound in `env`. If so, nothing
+ * looked up from `env` can be found in `other`, so `other` may be skipped over
+ * when it is `env`'s parent.
+ *
+ */
+bool shadows_env(Env *env, Env *other) {
+  if (other->count > env->count) {
+    return false;
+  }
+  for (size_t index = 0; index < other->count; index++) {
+    if (find_entry(env, other->entries[index].key) == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // =================================
 // Lye environment-related functions
 // =================================
@@ -180,16 +317,18 @@ Value *put_global_value(Env *env, Value *key, Value *value, bool is_builtin) {
  * src/env.c:print_env
  * buildyourownlisp.com correspondence: none
  *
- * Print all the variables in the environment and their corresponding Values.
+ * Print all the variables in the environment and their corresponding Values,
+ * followed by how many heap Values are allocated in all.
  *
  */
 static void print_env(Env *env) {
   printf("Current environment:\n");
   for (size_t index = 0; index < env->count; index++) {
-    printf("    %s: ", env->keys[index]);
-    println_value(env->values[index]);
+    printf("    %s: ", env->entries[index].key);
+    println_value(env->entries[index].value);
   }
   printf("There are a total of %zu variables defined.\n", env->count);
+  printf("There are %zu values in memory.\n", live_values());
 }
 
 /*
@@ -209,6 +348,25 @@ Value *builtin_print_env(Env *env, Value *value) {
 // Lye builtin registering
 // =======================
 
+/*
+ * src/env.c:find_builtin
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the builtin that the given name refers to in the global Env, or NULL
+ * if it refers to anything else.
+ *
+ */
+Builtin find_builtin(Symbol name) {
+  size_t slot = symbol_info(name)->global_slot;
+  if (global_env == NULL || slot == 0 ||
+      !global_env->entries[slot - 1].is_builtin) {
+    return NULL;
+  }
+
+  Value *value = global_env->entries[slot - 1].value;
+  return IS_FUNCTION(value) ? value->data.function->builtin : NULL;
+}
+
 /*
  * src/env.c:register_builtin
  * buildyourownlisp.com correspondence: lenv_add_builtin
@@ -216,10 +374,10 @@ Value *builtin_print_env(Env *env, Value *value) {
  * Make the given built-in available for any Lye program.
  *
  */
-static void register_builtin(Env *env, Symbol name, Builtin builtin) {
+static void register_builtin(Env *env, char const *name, Builtin builtin) {
   Value *key = make_symbol(name);
   Value *function = make_builtin(name, builtin);
-  put_global_value(env, key, function, true);
+  delete_value(put_global_value(env, key, function, true));
   delete_value(key);
   delete_value(function);
 }
@@ -228,10 +386,12 @@ static void register_builtin(Env *env, Symbol name, Builtin builtin) {
  * src/env.c:register_builtins
  * buildyourownlisp.com correspondence: lenv_add_builtins
  *
- * Register the set of all built-ins.
+ * Register the set of all built-ins, in what thereby becomes the global Env.
  *
  */
 void register_builtins(Env *env) {
+  global_env = env;
+
   Builtin builtin_functions[BUILTINS_COUNT] = {
       /* Environment and function operations */
       builtin_def, builtin_put, builtin_lambda, builtin_print_env,
@@ -239,17 +399,22 @@ void register_builtins(Env *env) {
       /* List operations */
       builtin_list, builtin_eval, builtin_head, builtin_tail, builtin_join,
       builtin_cons, builtin_length, builtin_reverse, builtin_init,
+      builtin_take, builtin_drop, builtin_slice,
 
       /* Arithmetical operations*/
       builtin_add, builtin_subtract, builtin_multiply, builtin_divide,
-      builtin_exp, builtin_modulo, builtin_min, builtin_max};
+      builtin_exp, builtin_modulo, builtin_min, builtin_max,
+
+      /* Vector operations */
+      builtin_to_vector, builtin_to_list, builtin_sum, builtin_dot};
 
   for (size_t index = 0; index < BUILTINS_COUNT; index++) {
     register_builtin(env, builtin_names[index], builtin_functions[index]);
   }
 
   /* `quit` is a fake builtin */
+  quit_name = intern("quit");
   Value *quit = make_symbol("quit");
-  put_global_value(env, quit, quit, true);
+  delete_value(put_global_value(env, quit, quit, true));
   delete_value(quit);
 }
@@ -17,32 +17,52 @@
 #include "list.h"
 #include "value.h"
 
+/* Declare a single binding: a key, its Value and whether it is a builtin */
+typedef struct EnvEntry {
+  Symbol key;
+  Value *value;
+  bool is_builtin;
+} EnvEntry;
+
+/* Envs with at most this many entries are searched linearly, and have no
+index */
+#define ENV_INDEX_MIN 8
+
 /*
  * buildyourownlisp.com correspondence: lenv
  *
- * Define the Env struct. It is implemented as a pair of lists plus their
- * length, with the invariant that the length is equal for both.
+ * Define the Env struct. Its entries are kept in an array, in the order they
+ * were defined, which grows geometrically. Envs with more than ENV_INDEX_MIN
+ * entries also have an index: an open-addressed hash table, keyed on the
+ * precomputed hash of each Symbol, that holds the position of each entry plus
+ * one (zero marks an empty slot). Its capacity is a power of two, and it is
+ * kept at most half full.
  *
  */
 struct Env {
   Env *parent;
   size_t count;
-  Symbol *keys;
-  Value **values;
-  bool *is_builtin;
+  size_t capacity;
+  EnvEntry *entries;
+  size_t index_capacity;
+  size_t *index;
 };
 
 /* Environment constructors and destructor */
 Env *make_env();
 Env *copy_env(Env const *old);
 void delete_env(Env *env);
+void destroy_env(Env *env);
 
 /* Store and retrieve */
 Value *get_value(Env *env, Value *key);
 Value *put_local_value(Env *env, Value *key, Value *value, bool is_builtin);
 Value *put_global_value(Env *env, Value *key, Value *value, bool is_builtin);
+bool shadows_env(Env *env, Env *other);
 
 /* Register language built-ins */
 void register_builtins(Env *env);
+Builtin find_builtin(Symbol name);
+Value *builtin_print_env(Env *env, Value *value);
 
 #endif
\ No newline at end of file
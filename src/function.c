@@ -3,17 +3,16 @@
 #include "env.h"
 
 /*
- * src/function.c:call
+ * src/function.c:bind_arguments
  * buildyourownlisp.com correspondence: lval_call
  *
- * Call a function, whether builtin or user-defined.
+ * Bind arguments to the parameters of a user-defined function, returning the
+ * function with its Env updated (or an error). `is_complete` tells whether
+ * every parameter is now bound, in which case the caller runs the body; if
+ * not, the result is a partially applied function. Both the function and its
+ * arguments are consumed.
  */
-Value *call(Env *env, Value *fun, Value *args) {
-  /* If the function is a builtin we simply call that */
-  if (fun->data.function->builtin) {
-    return fun->data.function->builtin(env, args);
-  }
-
+Value *bind_arguments(Value *fun, Value *args, bool *is_complete) {
   size_t argc = count(args);
   size_t paramc = count(fun->data.function->params);
 
@@ -27,24 +26,21 @@ Value *call(Env *env, Value *fun, Value *args) {
     return error;
   }
 
+  /* Binding the arguments changes the function's Env, so if the function is
+  shared (e.g. it is still stored in a variable) we work on a copy of it */
+  fun = unshare_value(fun);
+
   /* Assign arguments to parameters */
   for (size_t index = 0; index < argc; index++) {
-    put_local_value(fun->data.function->env,
-                    fun->data.function->params->data.sexpr.cell[index],
-                    args->data.sexpr.cell[index], false);
-  }
-  delete_value(args);
-
-  if (argc == paramc) {
-    /* Evaluate a fully applied function */
-    fun->data.function->env->parent = env;
-    return builtin_eval(
+    delete_value(put_local_value(
         fun->data.function->env,
-        append_value(make_sexpr(), copy_value(fun->data.function->body)));
+        fun->data.function->params->data.sexpr.cell[index],
+        args->data.sexpr.cell[index], false));
   }
+  delete_value(args);
 
-  /* Return a partially applied function */
-  return copy_value(fun);
+  *is_complete = argc == paramc;
+  return fun;
 }
 
 /*
@@ -70,18 +66,21 @@ static Value *builtin_var(Env *env, Value *value, char *fun) {
 
   /* Assign copies of values to symbols. The operation might fail if the user
   tries to redefine a Lye builtin. */
-  Value *maybe_error;
+  Value *maybe_error = NULL;
   size_t index;
   Value *(*put_value)(Env *, Value *, Value *, bool) =
       strcmp(fun, "def") == 0 ? put_global_value : put_local_value;
 
   for (index = 0; index < count(symbols); index++) {
+    if (maybe_error) {
+      delete_value(maybe_error);
+    }
     maybe_error = put_value(env, element_at(symbols, index),
                             element_at(value, index + 1), false);
   }
 
-  delete_value(symbols);
-  return maybe_error;
+  delete_value(value);
+  return maybe_error ? maybe_error : make_sexpr();
 }
 
 /*
@@ -110,6 +109,53 @@ Value *builtin_put(Env *env, Value *value) {
   return builtin_var(env, value, "=");
 }
 
+/*
+ * src/function.c:resolve_params
+ * buildyourownlisp.com correspondence: none
+ *
+ * Give every parameter used in the body of a lambda the position where
+ * `bind_arguments` binds it in the lambda's Env, so that `get_value` can find
+ * it there without a search. Nested S-expressions are resolved too, as they
+ * are evaluated in the same Env; nested Q-expressions are not, since they may
+ * end up evaluated anywhere. The positions are only hints, checked when used,
+ * so this does not change the meaning of the body even if it is shared with
+ * other Values.
+ *
+ */
+static void resolve_params(Value *params, Value *body) {
+  /* Nested S-expressions are kept on an explicit stack rather than recursed
+  into, so there is no limit to how deeply they may be nested */
+  size_t capacity = 16;
+  size_t depth = 0;
+  Value **pending = malloc(sizeof(Value *) * capacity);
+
+  pending[depth++] = body;
+  while (depth > 0) {
+    Value *list = pending[--depth];
+    for (size_t index = 0; index < count(list); index++) {
+      Value *element = element_at(list, index);
+      if (IS_SEXPR(element)) {
+        if (depth == capacity) {
+          capacity *= 2;
+          pending = realloc(pending, sizeof(Value *) * capacity);
+        }
+        pending[depth++] = element;
+      } else if (IS_SYMBOL(element)) {
+        element->data.symbol.slot = 0;
+        for (size_t param = 0; param < count(params); param++) {
+          if (element_at(params, param)->data.symbol.name ==
+              element->data.symbol.name) {
+            element->data.symbol.slot = param + 1;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  free(pending);
+}
+
 /*
  * src/function.c:builtin_lambda
  * buildyourownlisp.com correspondence: builtin_lambda
@@ -128,5 +174,6 @@ Value *builtin_lambda(__attribute__((unused)) Env *env, Value *code) {
   Value *body = pop(code);
   delete_value(code);
 
+  resolve_params(params, body);
   return make_lambda(params, body);
 }
@@ -8,6 +8,7 @@
 #define lye_function_h
 
 #include "assert.h"
+#include "compiler.h"
 #include "value.h"
 
 /* Define the Function struct */
@@ -15,13 +16,15 @@ struct Function {
   /* These two are only used by builtins */
   Symbol name;
   Builtin builtin;
-  /* These three are only used by user-defined functions */
+  /* These four are only used by user-defined functions; `code` is the
+  compiled `body` */
   Env *env;
   Value *params;
   Value *body;
+  Code *code;
 };
 
-Value *call(Env *env, Value *fun, Value *args);
+Value *bind_arguments(Value *fun, Value *args, bool *is_complete);
 Value *builtin_def(Env *env, Value *value);
 Value *builtin_put(Env *env, Value *value);
 Value *builtin_lambda(Env *env, Value *code);
@@ -0,0 +1,223 @@
+#include "gc.h"
+
+#include "env.h"
+
+GcConfig gc_config = {LYE_GC_THRESHOLD, LYE_GC_GROWTH, LYE_GC_BUDGET};
+unsigned gc_epoch = 0;
+
+/*
+ * A collection goes through these phases, one or more steps each:
+ * - MARKING: mark every Value reachable from the global Env, as it was when
+ *   the collection started (changes to Envs are reported by `shade_value`);
+ * - UNLINKING: have every unmarked Value drop its references to marked ones;
+ * - SWEEPING: free every unmarked Value.
+ *
+ */
+typedef enum { IDLE, MARKING, UNLINKING, SWEEPING } GcPhase;
+
+static GcPhase phase = IDLE;
+static size_t next_collection = LYE_GC_THRESHOLD;
+
+/* Marked Values whose children have not been marked yet */
+static Value **grey = NULL;
+static size_t grey_count = 0;
+static size_t grey_capacity = 0;
+
+/* How far into the global Env the marking has gone */
+static size_t root_index = 0;
+
+/*
+ * src/gc.c:configure_collector
+ * buildyourownlisp.com correspondence: none
+ *
+ * Read the collector settings from the environment variables LYE_GC_THRESHOLD,
+ * LYE_GC_GROWTH and LYE_GC_BUDGET, keeping the defaults for any that are
+ * missing or invalid.
+ *
+ */
+void configure_collector(void) {
+  char *setting;
+  char *end;
+
+  if ((setting = getenv("LYE_GC_THRESHOLD"))) {
+    unsigned long threshold = strtoul(setting, &end, 10);
+    if (*end == '\0' && end != setting) {
+      gc_config.threshold = threshold;
+    }
+  }
+  if ((setting = getenv("LYE_GC_GROWTH"))) {
+    double growth = strtod(setting, &end);
+    if (*end == '\0' && growth >= 1.0) {
+      gc_config.growth = growth;
+    }
+  }
+  if ((setting = getenv("LYE_GC_BUDGET"))) {
+    unsigned long budget = strtoul(setting, &end, 10);
+    if (*end == '\0' && budget > 0) {
+      gc_config.budget = budget;
+    }
+  }
+
+  next_collection = gc_config.threshold;
+}
+
+// Check if a heap Value was marked in the current collection
+static inline bool is_marked(Value *value) { return value->mark == gc_epoch; }
+
+/*
+ * src/gc.c:shade_value
+ * buildyourownlisp.com correspondence: none
+ *
+ * Mark a Value and queue it so that its children get marked as well. This
+ * must be called on any Value that an Env is about to let go of: it may be
+ * reachable from another place the marking has not visited yet.
+ *
+ */
+void shade_value(Value *value) {
+  if (phase != MARKING || IS_IMMEDIATE(value) || is_marked(value)) {
+    return;
+  }
+
+  value->mark = gc_epoch;
+  if (grey_count == grey_capacity) {
+    grey_capacity = grey_capacity ? grey_capacity * 2 : 256;
+    grey = realloc(grey, sizeof(Value *) * grey_capacity);
+  }
+  /* The queue holds a reference, so the Value cannot be freed while in it */
+  grey[grey_count++] = copy_value(value);
+}
+
+/*
+ * src/gc.c:mark
+ * buildyourownlisp.com correspondence: none
+ *
+ * Mark Values reachable from the global Env, up to the budget. Return true
+ * once there is nothing left to mark.
+ *
+ */
+static bool mark(Env *env, size_t budget) {
+  for (; budget > 0; budget--) {
+    if (root_index < env->count) {
+      shade_value(env->entries[root_index++].value);
+    } else if (grey_count > 0) {
+      Value *value = grey[--grey_count];
+      visit_children(value, shade_value);
+      delete_value(value);
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Drop a reference held by a Value about to be swept, if it is to a survivor
+static void release_if_marked(Value *child) {
+  if (!IS_IMMEDIATE(child) && is_marked(child)) {
+    delete_value(child);
+  }
+}
+
+/*
+ * src/gc.c:unlink_garbage
+ * buildyourownlisp.com correspondence: none
+ *
+ * Have unmarked Values drop their references to marked Values, up to the
+ * budget, so that the survivors' reference counts stay right. Unmarked
+ * Values are not freed yet, since they may still be pointed to by other
+ * unmarked Values. Return true once every Value has been visited.
+ *
+ */
+static bool unlink_garbage(size_t budget) {
+  for (; budget > 0; budget--) {
+    Value *value = walk_values_next();
+    if (value == NULL) {
+      return true;
+    }
+    if (!is_marked(value)) {
+      visit_children(value, release_if_marked);
+    }
+  }
+  return false;
+}
+
+/*
+ * src/gc.c:sweep
+ * buildyourownlisp.com correspondence: none
+ *
+ * Free unmarked Values, up to the budget. Return true once every Value has
+ * been visited.
+ *
+ */
+static bool sweep(size_t budget) {
+  for (; budget > 0; budget--) {
+    Value *value = walk_values_next();
+    if (value == NULL) {
+      return true;
+    }
+    if (!is_marked(value)) {
+      destroy_value(value);
+    }
+  }
+  return false;
+}
+
+/*
+ * src/gc.c:collect_garbage
+ * buildyourownlisp.com correspondence: none
+ *
+ * Perform one step of garbage collection, starting a new collection if the
+ * heap has grown enough since the last one. Must only be called between
+ * top-level evaluations, with `env` being the global Env.
+ *
+ */
+void collect_garbage(Env *env) {
+  switch (phase) {
+  case IDLE:
+    if (live_values() < next_collection) {
+      return;
+    }
+    /* Every existing Value becomes unmarked, and new ones will be marked */
+    gc_epoch++;
+    root_index = 0;
+    phase = MARKING;
+    break;
+  case MARKING:
+    if (mark(env, gc_config.budget)) {
+      walk_values_begin();
+      phase = UNLINKING;
+    }
+    break;
+  case UNLINKING:
+    if (unlink_garbage(gc_config.budget)) {
+      walk_values_begin();
+      phase = SWEEPING;
+    }
+    break;
+  case SWEEPING:
+    if (sweep(gc_config.budget)) {
+      size_t grown = (size_t)((double)live_values() * gc_config.growth);
+      next_collection =
+          grown > gc_config.threshold ? grown : gc_config.threshold;
+      phase = IDLE;
+    }
+    break;
+  }
+}
+
+/*
+ * src/gc.c:release_collector
+ * buildyourownlisp.com correspondence: none
+ *
+ * Abandon any collection in progress and free the collector's own memory, at
+ * the end of the program.
+ *
+ */
+void release_collector(void) {
+  while (grey_count > 0) {
+    delete_value(grey[--grey_count]);
+  }
+  free(grey);
+  grey = NULL;
+  grey_capacity = 0;
+  phase = IDLE;
+}
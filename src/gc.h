@@ -0,0 +1,53 @@
+/*
+ * src/gc.h
+ *
+ * Define the tracing garbage collector. Reference counting frees most Values
+ * as soon as they are no longer used; the collector finds whatever it cannot,
+ * such as Values that are no longer reachable but whose reference count never
+ * dropped to zero. It is an incremental mark-sweep collector: each call to
+ * `collect_garbage` does a bounded amount of work, so a collection is spread
+ * over many steps.
+ *
+ * Steps only happen between top-level evaluations, where the only way to get
+ * to a Value is through the global Env, which is therefore the only root.
+ *
+ */
+#ifndef lye_gc_h
+#define lye_gc_h
+
+#include "value.h"
+
+/* Defaults for the collector settings, which may also be set at runtime from
+the environment variables of the same name */
+#ifndef LYE_GC_THRESHOLD
+#define LYE_GC_THRESHOLD 100000
+#endif
+#ifndef LYE_GC_GROWTH
+#define LYE_GC_GROWTH 2.0
+#endif
+#ifndef LYE_GC_BUDGET
+#define LYE_GC_BUDGET 10000
+#endif
+
+/* Define the collector settings */
+typedef struct GcConfig {
+  /* No collection starts while fewer Values than this are allocated */
+  size_t threshold;
+  /* After a collection, the next one starts once the heap has grown by this
+  factor over the Values that survived */
+  double growth;
+  /* Maximum number of Values marked or swept in a single step */
+  size_t budget;
+} GcConfig;
+
+extern GcConfig gc_config;
+
+/* Values whose mark equals the current epoch are marked */
+extern unsigned gc_epoch;
+
+void configure_collector(void);
+void collect_garbage(Env *env);
+void shade_value(Value *value);
+void release_collector(void);
+
+#endif
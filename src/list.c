@@ -14,6 +14,7 @@
  *
  */
 Value *builtin_list(__attribute__((unused)) Env *env, Value *value) {
+  value = unshare_value(value);
   value->type = QEXPR;
   return value;
 }
@@ -35,15 +36,8 @@ Value *builtin_head(__attribute__((unused)) Env *env, Value *value) {
   /* Otherwise take the first element. */
   value = take_value(value, 0);
 
-  /* Delete all elements that are not head and return */
-  while (value->data.sexpr.count > 1) {
-    delete_value(pop_value(value, 1));
-  }
-
-  /* Return the actual first element */
-  Value *result = pop(value);
-  delete_value(value);
-  return result;
+  /* Return the actual first element, letting go of the rest of the list */
+  return take_value(value, 0);
 }
 
 /*
@@ -51,7 +45,7 @@ Value *builtin_head(__attribute__((unused)) Env *env, Value *value) {
  * buildyourownlisp.com correspondence: builtin_tail
  *
  * Take a list and return a list containing all of its elements but the first
- * one.
+ * one. The result is a view of the list, so no elements are copied.
  *
  */
 Value *builtin_tail(__attribute__((unused)) Env *env, Value *value) {
@@ -60,12 +54,9 @@ Value *builtin_tail(__attribute__((unused)) Env *env, Value *value) {
   ASSERT_IS_LIST(value, 0, "tail");
   ASSERT_CONTAINS_VALUES(value, "tail");
 
-  /* Take first argument */
-  Value *result = take_value(value, 0);
-
-  /* Delete first argument and return */
-  delete_value(pop(result));
-  return result;
+  /* Take the first argument, and view all of it but its first element */
+  Value *list = take_value(value, 0);
+  return slice_value(list, 1, count(list) - 1);
 }
 
 /*
@@ -84,16 +75,9 @@ Value *builtin_join(__attribute__((unused)) Env *env, Value *value) {
   // Build result from the first list contained in the sexpr argument
   Value *result = pop(value);
 
-  // As long as there are other lists
+  // Append every other list to the result, in order
   while (count(value) > 0) {
-    // and elements in the first list
-    while (count(value->data.sexpr.cell[0]) > 0) {
-      // append the first element of the first list to the result
-      Value *next = pop(value->data.sexpr.cell[0]);
-      result = append_value(result, next);
-    }
-    // We pop from the S-expr the Q-expr being appended, which is now empty
-    delete_value(pop(value));
+    result = join_values(result, pop(value));
   }
 
   delete_value(value);
@@ -111,7 +95,7 @@ Value *builtin_eval(Env *env, Value *value) {
   ASSERT_ARGC(value, 1, "eval");
   ASSERT_IS_LIST(value, 0, "eval");
 
-  Value *sexpr = take_value(value, 0);
+  Value *sexpr = unshare_value(take_value(value, 0));
   sexpr->type = SEXPR;
   return evaluate(env, sexpr);
 }
@@ -120,33 +104,16 @@ Value *builtin_eval(Env *env, Value *value) {
  * src/list.c:builtin_cons
  * buildyourownlisp.com correspondence: none
  *
- * Take a Value and a list and prepend the Value to the list.
+ * Take a Value and a list and prepend the Value to the list. The list itself
+ * is left as it was, but usually shares its elements with the result.
  *
  */
 Value *builtin_cons(__attribute__((unused)) Env *env, Value *value) {
   ASSERT_ARGC(value, 2, "cons");
   ASSERT_IS_LIST(value, 1, "cons");
 
-  Value *new_element = copy_value(element_at(value, 0));
-  Value *list = copy_value(element_at(value, 1));
-  delete_value(value);
-
-  /* Set new size of Q-expr */
-  list->data.sexpr.count++;
-
-  /* Allocate larger memory */
-  list->data.sexpr.cell =
-      realloc(list->data.sexpr.cell, sizeof(Value *) * count(list));
-
-  /* Shift the list one element to the right */
-  for (size_t index = count(list) - 1; index > 0; index--) {
-    list->data.sexpr.cell[index] = list->data.sexpr.cell[index - 1];
-  }
-
-  /* Set the correct pointers */
-  list->data.sexpr.cell[0] = new_element;
-
-  return list;
+  Value *list = pop_value(value, 1);
+  return prepend_value(list, take_value(value, 0));
 }
 
 /*
@@ -178,7 +145,7 @@ Value *builtin_reverse(__attribute__((unused)) Env *env, Value *value) {
   ASSERT_ARGC(value, 1, "reverse");
   ASSERT_IS_LIST(value, 0, "reverse");
 
-  Value *list = copy_value(element_at(value, 0));
+  Value *list = unshare_value(take_value(value, 0));
   size_t length = count(list);
 
   for (size_t index = 0; index < length / 2; index++) {
@@ -187,7 +154,6 @@ Value *builtin_reverse(__attribute__((unused)) Env *env, Value *value) {
     list->data.sexpr.cell[length - index - 1] = tmp;
   }
 
-  delete_value(value);
   return list;
 }
 
@@ -196,7 +162,8 @@ Value *builtin_reverse(__attribute__((unused)) Env *env, Value *value) {
  * buildyourownlisp.com correspondence: none
  *
  * Take a list and return a new list with all its elements but the last one.
- * Conceptually equivalent to reverse-tail-reverse.
+ * Conceptually equivalent to reverse-tail-reverse. The result is a view of the
+ * list, so no elements are copied.
  *
  */
 Value *builtin_init(__attribute__((unused)) Env *env, Value *value) {
@@ -204,9 +171,72 @@ Value *builtin_init(__attribute__((unused)) Env *env, Value *value) {
   ASSERT_IS_LIST(value, 0, "init");
   ASSERT_CONTAINS_VALUES(value, "init");
 
-  Value *result = copy_value(element_at(value, 0));
-  delete_value(value);
-  delete_value(pop_value(result, count(result) - 1));
+  Value *list = take_value(value, 0);
+  return slice_value(list, 0, count(list) - 1);
+}
 
-  return result;
+/*
+ * src/list.c:builtin_take
+ * buildyourownlisp.com correspondence: none
+ *
+ * Take a number n and a list, and return a list of the first n elements of
+ * the list, or all of them if it is shorter. The result is a view of the list.
+ *
+ */
+Value *builtin_take(__attribute__((unused)) Env *env, Value *value) {
+  ASSERT_ARGC(value, 2, "take");
+  ASSERT_IS_INDEX(value, 0, "take");
+  ASSERT_IS_LIST(value, 1, "take");
+
+  double wanted = number_of(element_at(value, 0));
+  Value *list = take_value(value, 1);
+  size_t length = count(list);
+  return slice_value(list, 0,
+                     wanted < (double)length ? (size_t)wanted : length);
+}
+
+/*
+ * src/list.c:builtin_drop
+ * buildyourownlisp.com correspondence: none
+ *
+ * Take a number n and a list, and return a list of all but the first n
+ * elements of the list, which is empty if it is shorter. The result is a view
+ * of the list.
+ *
+ */
+Value *builtin_drop(__attribute__((unused)) Env *env, Value *value) {
+  ASSERT_ARGC(value, 2, "drop");
+  ASSERT_IS_INDEX(value, 0, "drop");
+  ASSERT_IS_LIST(value, 1, "drop");
+
+  double unwanted = number_of(element_at(value, 0));
+  Value *list = take_value(value, 1);
+  size_t length = count(list);
+  size_t offset = unwanted < (double)length ? (size_t)unwanted : length;
+  return slice_value(list, offset, length - offset);
+}
+
+/*
+ * src/list.c:builtin_slice
+ * buildyourownlisp.com correspondence: none
+ *
+ * Take two numbers, start and end, and a list, and return a list of the
+ * elements of the list from position start (counting from zero) up to, but not
+ * including, position end. Positions past the end of the list are taken to be
+ * its end. The result is a view of the list.
+ *
+ */
+Value *builtin_slice(__attribute__((unused)) Env *env, Value *value) {
+  ASSERT_ARGC(value, 3, "slice");
+  ASSERT_IS_INDEX(value, 0, "slice");
+  ASSERT_IS_INDEX(value, 1, "slice");
+  ASSERT_IS_LIST(value, 2, "slice");
+
+  double first = number_of(element_at(value, 0));
+  double last = number_of(element_at(value, 1));
+  Value *list = take_value(value, 2);
+  size_t length = count(list);
+  size_t end = last < (double)length ? (size_t)last : length;
+  size_t start = first < (double)end ? (size_t)first : end;
+  return slice_value(list, start, end - start);
 }
@@ -19,5 +19,8 @@ Value *builtin_cons(Env *env, Value *value);
 Value *builtin_length(Env *env, Value *value);
 Value *builtin_reverse(Env *env, Value *value);
 Value *builtin_init(Env *env, Value *value);
+Value *builtin_take(Env *env, Value *value);
+Value *builtin_drop(Env *env, Value *value);
+Value *builtin_slice(Env *env, Value *value);
 
 #endif
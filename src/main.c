@@ -7,19 +7,65 @@
  */
 #include "../utils/file.h"
 
+#include "gc.h"
+#include "reader.h"
 #include "repl.h"
+#include "symbol.h"
+#include "vm.h"
 
 /*
  * src/main.c:run_file
  * buildyourownlisp.com correspondence: none
  *
- * Interpret code contained in a Lye source file.
+ * Interpret code contained in a Lye source file. The file is mapped into
+ * memory rather than copied, and read from there.
  *
  */
 static void run_file(Env *env, char *filename) {
-  char *source = read_file(filename);
-  run_string(env, source);
-  free(source);
+  MappedFile source;
+  if (map_file(filename, &source)) {
+    run_string(env, source.text, source.size);
+    unmap_file(&source);
+  }
+}
+
+/*
+ * src/main.c:parallel_file
+ * buildyourownlisp.com correspondence: none
+ *
+ * Interpret code contained in a Lye source file, which is read on several
+ * threads at once and then run one top-level expression at a time.
+ *
+ */
+static void parallel_file(Env *env, char *filename, bool print) {
+  MappedFile source;
+  if (map_file(filename, &source)) {
+    run_parallel(env, source.text, source.size, print);
+    unmap_file(&source);
+  }
+}
+
+/*
+ * src/main.c:stream_file
+ * buildyourownlisp.com correspondence: none
+ *
+ * Interpret code from a Lye source file, or from standard input if the name is
+ * missing or "-", one top-level expression at a time.
+ *
+ */
+static void stream_file(Env *env, char *filename, bool print) {
+  if (filename == NULL || strcmp(filename, "-") == 0) {
+    run_stream(env, stdin, print);
+    return;
+  }
+
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open file \"%s\".\n", filename);
+    return;
+  }
+  run_stream(env, file, print);
+  fclose(file);
 }
 
 /*
@@ -30,24 +76,47 @@ static void run_file(Env *env, char *filename) {
  * it opens a REPL. If a single argument is passed, it is assumed to be a source
  * file which is then interpreted. The `-s` command line option allows for Lye
  * code, enclosed within quote marks, to be passed directly as an argument to be
- * executed.
+ * executed. The `--stream` and `--stream-print` options run a file (or standard
+ * input) one top-level expression at a time, the latter printing each value.
+ * `--parallel` and `--parallel-print` do the same for a file, which is read on
+ * several threads first.
  *
  */
 int main(int argc, char **argv) {
+  configure_collector();
+  configure_vm();
+  configure_reader();
+  create_parser();
   Env *environment = make_env();
   register_builtins(environment);
 
-  if (argc == 1) {
+  bool is_stream = argc > 1 && (strcmp(argv[1], "--stream") == 0 ||
+                                strcmp(argv[1], "--stream-print") == 0);
+  bool is_parallel = argc == 3 && (strcmp(argv[1], "--parallel") == 0 ||
+                                   strcmp(argv[1], "--parallel-print") == 0);
+
+  if (is_stream && argc <= 3) {
+    stream_file(environment, argc == 3 ? argv[2] : NULL,
+                strcmp(argv[1], "--stream-print") == 0);
+  } else if (is_parallel) {
+    parallel_file(environment, argv[2],
+                  strcmp(argv[1], "--parallel-print") == 0);
+  } else if (argc == 1) {
     puts("Lye Version 0.0.0.11");
     puts("Enter 'quit' to exit\n");
     repl(environment);
   } else if (argc == 2) {
     run_file(environment, argv[1]);
   } else if (argc == 3 && strcmp(argv[1], "-s") == 0) {
-    run_string(environment, argv[2]);
+    run_string(environment, argv[2], strlen(argv[2]));
   }
 
+  cleanup_parser();
+  release_vm();
+  release_collector();
   delete_env(environment);
+  release_values();
+  release_symbols();
 
   return 0;
 }
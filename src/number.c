@@ -0,0 +1,677 @@
+#include "number.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The most digits a literal may have for them all to fit in a uint64_t */
+#define MAX_DIGITS 19
+
+/* The largest integer below which every integer is exactly a double */
+#define EXACT_LIMIT ((uint64_t)1 << 53)
+
+/* Powers of ten that are exactly doubles, for the quick cases */
+static double const EXACT_POWERS[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* The smallest power of ten in POWERS */
+#define MIN_POWER (-64)
+
+/* The 128 most significant bits of the powers of ten from 1e-64 up to 1e0,
+rounded down, as {high, low} halves. Literals with more digits after the dot
+than this are left to `strtod` */
+static uint64_t const POWERS[][2] = {
+    {0xA87FEA27A539E9A5, 0x3F2398D747B36224}, /* 1e-64 */
+    {0xD29FE4B18E88640E, 0x8EEC7F0D19A03AAD}, /* 1e-63 */
+    {0x83A3EEEEF9153E89, 0x1953CF68300424AC}, /* 1e-62 */
+    {0xA48CEAAAB75A8E2B, 0x5FA8C3423C052DD7}, /* 1e-61 */
+    {0xCDB02555653131B6, 0x3792F412CB06794D}, /* 1e-60 */
+    {0x808E17555F3EBF11, 0xE2BBD88BBEE40BD0}, /* 1e-59 */
+    {0xA0B19D2AB70E6ED6, 0x5B6ACEAEAE9D0EC4}, /* 1e-58 */
+    {0xC8DE047564D20A8B, 0xF245825A5A445275}, /* 1e-57 */
+    {0xFB158592BE068D2E, 0xEED6E2F0F0D56712}, /* 1e-56 */
+    {0x9CED737BB6C4183D, 0x55464DD69685606B}, /* 1e-55 */
+    {0xC428D05AA4751E4C, 0xAA97E14C3C26B886}, /* 1e-54 */
+    {0xF53304714D9265DF, 0xD53DD99F4B3066A8}, /* 1e-53 */
+    {0x993FE2C6D07B7FAB, 0xE546A8038EFE4029}, /* 1e-52 */
+    {0xBF8FDB78849A5F96, 0xDE98520472BDD033}, /* 1e-51 */
+    {0xEF73D256A5C0F77C, 0x963E66858F6D4440}, /* 1e-50 */
+    {0x95A8637627989AAD, 0xDDE7001379A44AA8}, /* 1e-49 */
+    {0xBB127C53B17EC159, 0x5560C018580D5D52}, /* 1e-48 */
+    {0xE9D71B689DDE71AF, 0xAAB8F01E6E10B4A6}, /* 1e-47 */
+    {0x9226712162AB070D, 0xCAB3961304CA70E8}, /* 1e-46 */
+    {0xB6B00D69BB55C8D1, 0x3D607B97C5FD0D22}, /* 1e-45 */
+    {0xE45C10C42A2B3B05, 0x8CB89A7DB77C506A}, /* 1e-44 */
+    {0x8EB98A7A9A5B04E3, 0x77F3608E92ADB242}, /* 1e-43 */
+    {0xB267ED1940F1C61C, 0x55F038B237591ED3}, /* 1e-42 */
+    {0xDF01E85F912E37A3, 0x6B6C46DEC52F6688}, /* 1e-41 */
+    {0x8B61313BBABCE2C6, 0x2323AC4B3B3DA015}, /* 1e-40 */
+    {0xAE397D8AA96C1B77, 0xABEC975E0A0D081A}, /* 1e-39 */
+    {0xD9C7DCED53C72255, 0x96E7BD358C904A21}, /* 1e-38 */
+    {0x881CEA14545C7575, 0x7E50D64177DA2E54}, /* 1e-37 */
+    {0xAA242499697392D2, 0xDDE50BD1D5D0B9E9}, /* 1e-36 */
+    {0xD4AD2DBFC3D07787, 0x955E4EC64B44E864}, /* 1e-35 */
+    {0x84EC3C97DA624AB4, 0xBD5AF13BEF0B113E}, /* 1e-34 */
+    {0xA6274BBDD0FADD61, 0xECB1AD8AEACDD58E}, /* 1e-33 */
+    {0xCFB11EAD453994BA, 0x67DE18EDA5814AF2}, /* 1e-32 */
+    {0x81CEB32C4B43FCF4, 0x80EACF948770CED7}, /* 1e-31 */
+    {0xA2425FF75E14FC31, 0xA1258379A94D028D}, /* 1e-30 */
+    {0xCAD2F7F5359A3B3E, 0x096EE45813A04330}, /* 1e-29 */
+    {0xFD87B5F28300CA0D, 0x8BCA9D6E188853FC}, /* 1e-28 */
+    {0x9E74D1B791E07E48, 0x775EA264CF55347D}, /* 1e-27 */
+    {0xC612062576589DDA, 0x95364AFE032A819D}, /* 1e-26 */
+    {0xF79687AED3EEC551, 0x3A83DDBD83F52204}, /* 1e-25 */
+    {0x9ABE14CD44753B52, 0xC4926A9672793542}, /* 1e-24 */
+    {0xC16D9A0095928A27, 0x75B7053C0F178293}, /* 1e-23 */
+    {0xF1C90080BAF72CB1, 0x5324C68B12DD6338}, /* 1e-22 */
+    {0x971DA05074DA7BEE, 0xD3F6FC16EBCA5E03}, /* 1e-21 */
+    {0xBCE5086492111AEA, 0x88F4BB1CA6BCF584}, /* 1e-20 */
+    {0xEC1E4A7DB69561A5, 0x2B31E9E3D06C32E5}, /* 1e-19 */
+    {0x9392EE8E921D5D07, 0x3AFF322E62439FCF}, /* 1e-18 */
+    {0xB877AA3236A4B449, 0x09BEFEB9FAD487C2}, /* 1e-17 */
+    {0xE69594BEC44DE15B, 0x4C2EBE687989A9B3}, /* 1e-16 */
+    {0x901D7CF73AB0ACD9, 0x0F9D37014BF60A10}, /* 1e-15 */
+    {0xB424DC35095CD80F, 0x538484C19EF38C94}, /* 1e-14 */
+    {0xE12E13424BB40E13, 0x2865A5F206B06FB9}, /* 1e-13 */
+    {0x8CBCCC096F5088CB, 0xF93F87B7442E45D3}, /* 1e-12 */
+    {0xAFEBFF0BCB24AAFE, 0xF78F69A51539D748}, /* 1e-11 */
+    {0xDBE6FECEBDEDD5BE, 0xB573440E5A884D1B}, /* 1e-10 */
+    {0x89705F4136B4A597, 0x31680A88F8953030}, /* 1e-9 */
+    {0xABCC77118461CEFC, 0xFDC20D2B36BA7C3D}, /* 1e-8 */
+    {0xD6BF94D5E57A42BC, 0x3D32907604691B4C}, /* 1e-7 */
+    {0x8637BD05AF6C69B5, 0xA63F9A49C2C1B10F}, /* 1e-6 */
+    {0xA7C5AC471B478423, 0x0FCF80DC33721D53}, /* 1e-5 */
+    {0xD1B71758E219652B, 0xD3C36113404EA4A8}, /* 1e-4 */
+    {0x83126E978D4FDF3B, 0x645A1CAC083126E9}, /* 1e-3 */
+    {0xA3D70A3D70A3D70A, 0x3D70A3D70A3D70A3}, /* 1e-2 */
+    {0xCCCCCCCCCCCCCCCC, 0xCCCCCCCCCCCCCCCC}, /* 1e-1 */
+    {0x8000000000000000, 0x0000000000000000}, /* 1e0 */
+};
+
+// Count the zero bits above the highest bit set in a (nonzero) number
+static inline unsigned leading_zeros(uint64_t number) {
+#ifdef __GNUC__
+  return (unsigned)__builtin_clzll(number);
+#else
+  unsigned count = 0;
+  while (!(number >> 63)) {
+    number <<= 1;
+    count++;
+  }
+  return count;
+#endif
+}
+
+// Multiply two 64-bit numbers into a 128-bit one, split in halves
+static inline void multiply(uint64_t left, uint64_t right, uint64_t *high,
+                            uint64_t *low) {
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 uint128_t;
+  uint128_t product = (uint128_t)left * right;
+  *high = (uint64_t)(product >> 64);
+  *low = (uint64_t)product;
+#else
+  uint64_t left_low = left & 0xFFFFFFFF, left_high = left >> 32;
+  uint64_t right_low = right & 0xFFFFFFFF, right_high = right >> 32;
+  uint64_t low_low = left_low * right_low;
+  uint64_t high_low = left_high * right_low;
+  uint64_t low_high = left_low * right_high;
+  uint64_t middle = (low_low >> 32) + (high_low & 0xFFFFFFFF) + low_high;
+  *high = left_high * right_high + (high_low >> 32) + (middle >> 32);
+  *low = (middle << 32) | (low_low & 0xFFFFFFFF);
+#endif
+}
+
+/*
+ * src/number.c:eisel_lemire
+ * buildyourownlisp.com correspondence: none
+ *
+ * Find the double nearest to `digits` times ten to the power of `exponent`,
+ * as described by Daniel Lemire in "Number Parsing at a Gigabyte per Second",
+ * after an idea of Michael Eisel. The digits are multiplied by a 128-bit
+ * approximation of the power of ten, which almost always decides the rounding;
+ * if it does not, or the result would not be a normal double, return false.
+ *
+ */
+static bool eisel_lemire(uint64_t digits, int exponent, double *number) {
+  unsigned shift = leading_zeros(digits);
+  digits <<= shift;
+
+  /* The power of two of the result, biased as a double stores it: the
+  product of the multiplication below has 127 or 128 bits, of which 64 are
+  attributed to the digits, and 217706 / 2^16 is just about log2(10) */
+  int64_t log2_power = exponent >= 0 ? (217706 * exponent) >> 16
+                                     : -((-217706 * exponent + 65535) >> 16);
+  uint64_t power2 = (uint64_t)(log2_power + 64 + 1023) - shift;
+
+  uint64_t const *power = POWERS[exponent - MIN_POWER];
+  uint64_t high, low;
+  multiply(digits, power[0], &high, &low);
+
+  /* The bits that decide the rounding may be wrong, because the power of ten
+  was cut short: check with the next 64 bits of it */
+  if ((high & 0x1FF) == 0x1FF && low + digits < digits) {
+    uint64_t next_high, next_low;
+    multiply(digits, power[1], &next_high, &next_low);
+    uint64_t merged_high = high, merged_low = low + next_high;
+    if (merged_low < low) {
+      merged_high++;
+    }
+    if ((merged_high & 0x1FF) == 0x1FF && merged_low + 1 == 0 &&
+        next_low + digits < digits) {
+      return false;
+    }
+    high = merged_high;
+    low = merged_low;
+  }
+
+  /* Keep 54 bits, one more than a double has, to round with */
+  uint64_t top = high >> 63;
+  uint64_t mantissa = high >> (top + 9);
+  power2 -= 1 ^ top;
+
+  /* Exactly halfway between two doubles, which is up to `strtod` */
+  if (low == 0 && (high & 0x1FF) == 0 && (mantissa & 3) == 1) {
+    return false;
+  }
+
+  mantissa += mantissa & 1;
+  mantissa >>= 1;
+  if (mantissa >> 53) {
+    mantissa >>= 1;
+    power2++;
+  }
+
+  /* Subnormal, infinite or NaN */
+  if (power2 - 1 >= 0x7FF - 1) {
+    return false;
+  }
+
+  uint64_t bits = power2 << 52 | (mantissa & (((uint64_t)1 << 52) - 1));
+  memcpy(number, &bits, sizeof(bits));
+  return true;
+}
+
+/*
+ * src/number.c:parse_hard
+ * buildyourownlisp.com correspondence: lval_read_num
+ *
+ * Convert a number literal of the given length to a double with `strtod`, for
+ * the cases that `parse_number` cannot do on its own. Return false if the
+ * number is too large or too small for a double.
+ *
+ */
+static bool parse_hard(char const *text, size_t length, double *number) {
+  /* `strtod` needs the number to end where the grammar says it does */
+  char small[64];
+  char *copy = length < sizeof(small) ? small : malloc(length + 1);
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+
+  errno = 0;
+  *number = strtod(copy, NULL);
+  if (copy != small) {
+    free(copy);
+  }
+  return errno != ERANGE;
+}
+
+/*
+ * src/number.c:parse_number
+ * buildyourownlisp.com correspondence: lval_read_num
+ *
+ * Convert a number literal of the given length to a double. The significant
+ * digits are gathered into an integer, with a power of ten to scale it by;
+ * integers, and decimals that a single division makes exact, are done at
+ * once, and most others by `eisel_lemire`. Return false if the number is too
+ * large or too small for a double, like `strtod` does.
+ *
+ */
+bool parse_number(char const *text, size_t length, double *number) {
+  bool is_negative = text[0] == '-';
+  size_t index = is_negative ? 1 : 0;
+  uint64_t digits = 0;
+  size_t significant = 0;
+  int exponent = 0;
+
+  /* Leading zeros are not significant, before or after the dot */
+  for (; index < length && text[index] != '.'; index++) {
+    if (digits > 0 || text[index] != '0') {
+      digits = digits * 10 + (uint64_t)(text[index] - '0');
+      significant++;
+    }
+  }
+  for (index++; index < length; index++) {
+    if (digits > 0 || text[index] != '0') {
+      digits = digits * 10 + (uint64_t)(text[index] - '0');
+      significant++;
+    }
+    exponent--;
+  }
+
+  /* Too many digits for the integer, or too far behind the dot */
+  if (significant > MAX_DIGITS || exponent < MIN_POWER) {
+    return parse_hard(text, length, number);
+  }
+
+  double value;
+  if (digits == 0) {
+    value = 0.0;
+  } else if (digits <= EXACT_LIMIT && exponent >= -22) {
+    /* Both the digits and the power of ten are exact, so dividing them is
+    rounded only once */
+    value = (double)digits / EXACT_POWERS[-exponent];
+  } else if (!eisel_lemire(digits, exponent, &value)) {
+    return parse_hard(text, length, number);
+  }
+  *number = is_negative ? -value : value;
+  return true;
+}
+
+// ==================
+// Formatting numbers
+// ==================
+
+/* The largest magnitude below which integers are printed without Grisu */
+#define INTEGER_LIMIT 9007199254740992.0
+
+/* Powers of ten that fit in 64 bits */
+static uint64_t const TEN_POWERS[] = {
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u,
+    1000000000u, 10000000000u, 100000000000u, 1000000000000u, 10000000000000u,
+    100000000000000u, 1000000000000000u, 10000000000000000u,
+    100000000000000000u, 1000000000000000000u, 10000000000000000000u};
+
+/* Define a floating point number as a 64-bit significand and a power of two,
+with none of the limits of a double ("do it yourself floating point") */
+typedef struct DiyFp {
+  uint64_t f;
+  int e;
+} DiyFp;
+
+/* Approximations of the powers of ten from 1e-348 to 1e340, eight at a time,
+each rounded to a 64-bit significand */
+static DiyFp const CACHED_POWERS[] = {
+    {0xFA8FD5A0081C0288, -1220}, {0xBAAEE17FA23EBF76, -1193},
+    {0x8B16FB203055AC76, -1166}, {0xCF42894A5DCE35EA, -1140},
+    {0x9A6BB0AA55653B2D, -1113}, {0xE61ACF033D1A45DF, -1087},
+    {0xAB70FE17C79AC6CA, -1060}, {0xFF77B1FCBEBCDC4F, -1034},
+    {0xBE5691EF416BD60C, -1007}, {0x8DD01FAD907FFC3C, -980},
+    {0xD3515C2831559A83, -954}, {0x9D71AC8FADA6C9B5, -927},
+    {0xEA9C227723EE8BCB, -901}, {0xAECC49914078536D, -874},
+    {0x823C12795DB6CE57, -847}, {0xC21094364DFB5637, -821},
+    {0x9096EA6F3848984F, -794}, {0xD77485CB25823AC7, -768},
+    {0xA086CFCD97BF97F4, -741}, {0xEF340A98172AACE5, -715},
+    {0xB23867FB2A35B28E, -688}, {0x84C8D4DFD2C63F3B, -661},
+    {0xC5DD44271AD3CDBA, -635}, {0x936B9FCEBB25C996, -608},
+    {0xDBAC6C247D62A584, -582}, {0xA3AB66580D5FDAF6, -555},
+    {0xF3E2F893DEC3F126, -529}, {0xB5B5ADA8AAFF80B8, -502},
+    {0x87625F056C7C4A8B, -475}, {0xC9BCFF6034C13053, -449},
+    {0x964E858C91BA2655, -422}, {0xDFF9772470297EBD, -396},
+    {0xA6DFBD9FB8E5B88F, -369}, {0xF8A95FCF88747D94, -343},
+    {0xB94470938FA89BCF, -316}, {0x8A08F0F8BF0F156B, -289},
+    {0xCDB02555653131B6, -263}, {0x993FE2C6D07B7FAC, -236},
+    {0xE45C10C42A2B3B06, -210}, {0xAA242499697392D3, -183},
+    {0xFD87B5F28300CA0E, -157}, {0xBCE5086492111AEB, -130},
+    {0x8CBCCC096F5088CC, -103}, {0xD1B71758E219652C, -77},
+    {0x9C40000000000000, -50}, {0xE8D4A51000000000, -24},
+    {0xAD78EBC5AC620000, 3}, {0x813F3978F8940984, 30},
+    {0xC097CE7BC90715B3, 56}, {0x8F7E32CE7BEA5C70, 83},
+    {0xD5D238A4ABE98068, 109}, {0x9F4F2726179A2245, 136},
+    {0xED63A231D4C4FB27, 162}, {0xB0DE65388CC8ADA8, 189},
+    {0x83C7088E1AAB65DB, 216}, {0xC45D1DF942711D9A, 242},
+    {0x924D692CA61BE758, 269}, {0xDA01EE641A708DEA, 295},
+    {0xA26DA3999AEF774A, 322}, {0xF209787BB47D6B85, 348},
+    {0xB454E4A179DD1877, 375}, {0x865B86925B9BC5C2, 402},
+    {0xC83553C5C8965D3D, 428}, {0x952AB45CFA97A0B3, 455},
+    {0xDE469FBD99A05FE3, 481}, {0xA59BC234DB398C25, 508},
+    {0xF6C69A72A3989F5C, 534}, {0xB7DCBF5354E9BECE, 561},
+    {0x88FCF317F22241E2, 588}, {0xCC20CE9BD35C78A5, 614},
+    {0x98165AF37B2153DF, 641}, {0xE2A0B5DC971F303A, 667},
+    {0xA8D9D1535CE3B396, 694}, {0xFB9B7CD9A4A7443C, 720},
+    {0xBB764C4CA7A44410, 747}, {0x8BAB8EEFB6409C1A, 774},
+    {0xD01FEF10A657842C, 800}, {0x9B10A4E5E9913129, 827},
+    {0xE7109BFBA19C0C9D, 853}, {0xAC2820D9623BF429, 880},
+    {0x80444B5E7AA7CF85, 907}, {0xBF21E44003ACDD2D, 933},
+    {0x8E679C2F5E44FF8F, 960}, {0xD433179D9C8CB841, 986},
+    {0x9E19DB92B4E31BA9, 1013}, {0xEB96BF6EBADF77D9, 1039},
+    {0xAF87023B9BF0EE6B, 1066},
+};
+
+/* The smallest power of ten in CACHED_POWERS, and the step between them */
+#define MIN_CACHED_POWER (-348)
+#define CACHED_POWER_STEP 8
+
+// Split a (positive, finite) double into a DiyFp of the same value
+static DiyFp diy_fp_of(double number) {
+  uint64_t bits;
+  memcpy(&bits, &number, sizeof(bits));
+  uint64_t significand = bits & (((uint64_t)1 << 52) - 1);
+  int biased = (int)(bits >> 52 & 0x7FF);
+  if (biased == 0) {
+    return (DiyFp){significand, 1 - 1075};
+  }
+  return (DiyFp){significand + ((uint64_t)1 << 52), biased - 1075};
+}
+
+// Multiply two DiyFps, keeping the top 64 bits of the product, rounded
+static DiyFp diy_multiply(DiyFp left, DiyFp right) {
+  uint64_t high, low;
+  multiply(left.f, right.f, &high, &low);
+  return (DiyFp){high + (low >> 63), left.e + right.e + 64};
+}
+
+// Shift a DiyFp left until the top bit of its significand is set
+static DiyFp diy_normalize(DiyFp number) {
+  unsigned shift = leading_zeros(number.f);
+  return (DiyFp){number.f << shift, number.e - (int)shift};
+}
+
+/*
+ * src/number.c:find_boundaries
+ * buildyourownlisp.com correspondence: none
+ *
+ * Find the numbers halfway between a double and its neighbours: any number
+ * strictly between them reads back as the same double. Both get the exponent
+ * of the upper one, which is normalized.
+ *
+ */
+static void find_boundaries(DiyFp number, DiyFp *lower, DiyFp *upper) {
+  *upper = diy_normalize((DiyFp){(number.f << 1) + 1, number.e - 1});
+
+  /* The neighbour below a power of two is closer than the one above */
+  if (number.f == (uint64_t)1 << 52) {
+    *lower = (DiyFp){(number.f << 2) - 1, number.e - 2};
+  } else {
+    *lower = (DiyFp){(number.f << 1) - 1, number.e - 1};
+  }
+  lower->f <<= lower->e - upper->e;
+  lower->e = upper->e;
+}
+
+/*
+ * src/number.c:cached_power
+ * buildyourownlisp.com correspondence: none
+ *
+ * Find a power of ten which, multiplied by a number with the given binary
+ * exponent, brings that exponent into the range [-60, -32], so that the digits
+ * can be generated with 64-bit integers alone. Set `power10` to minus its
+ * decimal exponent.
+ *
+ */
+static DiyFp cached_power(int exponent, int *power10) {
+  /* 0.30102999566398114 is log10(2) */
+  double estimate = (-61 - exponent) * 0.30102999566398114 + 347;
+  int k = (int)estimate;
+  if (estimate - k > 0.0) {
+    k++;
+  }
+  size_t index = (size_t)(k / CACHED_POWER_STEP + 1);
+  *power10 = -(MIN_CACHED_POWER + (int)index * CACHED_POWER_STEP);
+  return CACHED_POWERS[index];
+}
+
+// Count the decimal digits of a 32-bit number
+static unsigned count_digits(uint32_t number) {
+  unsigned count = 1;
+  while (count < 10 && number >= TEN_POWERS[count]) {
+    count++;
+  }
+  return count;
+}
+
+/*
+ * src/number.c:weed_digits
+ * buildyourownlisp.com correspondence: none
+ *
+ * Move the last digit generated towards the exact value of the number, as long
+ * as the digits stay within the boundaries and get closer to it. Since the
+ * scaled values are only accurate to within `unit`, `rest` (how far the digits
+ * are below the upper boundary) and `distance` (how far the number is) are
+ * not exact: return false if that could change which digits are closest, or
+ * whether they are within the boundaries at all.
+ *
+ */
+static bool weed_digits(char *digits, size_t length, uint64_t distance,
+                        uint64_t unsafe, uint64_t rest, uint64_t ten_kappa,
+                        uint64_t unit) {
+  uint64_t small_distance = distance - unit;
+  uint64_t big_distance = distance + unit;
+
+  while (rest < small_distance && unsafe - rest >= ten_kappa &&
+         (rest + ten_kappa < small_distance ||
+          small_distance - rest >= rest + ten_kappa - small_distance)) {
+    digits[length - 1]--;
+    rest += ten_kappa;
+  }
+
+  /* Would the digits have moved further if the number were a unit lower? */
+  if (rest < big_distance && unsafe - rest >= ten_kappa &&
+      (rest + ten_kappa < big_distance ||
+       big_distance - rest > rest + ten_kappa - big_distance)) {
+    return false;
+  }
+  return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+/*
+ * src/number.c:generate_digits
+ * buildyourownlisp.com correspondence: none
+ *
+ * Write the fewest digits that land between the boundaries of a number, which
+ * have been scaled by a power of ten. The integer part of the upper boundary
+ * is written first, then its fraction, one digit at a time, until the digits
+ * are close enough to it. Add the number of digits dropped to `power10`, and
+ * return false if the digits may not be the shortest or closest ones.
+ *
+ */
+static bool generate_digits(DiyFp lower, DiyFp number, DiyFp upper,
+                            char *digits, size_t *length, int *power10) {
+  /* Widen the boundaries by the error of the scaling: anything outside them
+  surely does not read back as the number */
+  uint64_t unit = 1;
+  uint64_t too_high = upper.f + unit;
+  uint64_t unsafe = too_high - (lower.f - unit);
+  uint64_t distance = too_high - number.f;
+
+  DiyFp one = {(uint64_t)1 << -upper.e, upper.e};
+  uint32_t integral = (uint32_t)(too_high >> -one.e);
+  uint64_t fraction = too_high & (one.f - 1);
+  unsigned kappa = integral ? count_digits(integral) : 0;
+  *length = 0;
+
+  while (kappa > 0) {
+    digits[(*length)++] =
+        (char)('0' + integral / TEN_POWERS[kappa - 1]);
+    integral = (uint32_t)(integral % TEN_POWERS[kappa - 1]);
+    kappa--;
+
+    uint64_t rest = ((uint64_t)integral << -one.e) + fraction;
+    if (rest < unsafe) {
+      *power10 += (int)kappa;
+      return weed_digits(digits, *length, distance, unsafe, rest,
+                         TEN_POWERS[kappa] << -one.e, unit);
+    }
+  }
+
+  for (int dropped = 1;; dropped++) {
+    fraction *= 10;
+    unit *= 10;
+    unsafe *= 10;
+    digits[(*length)++] = (char)('0' + (fraction >> -one.e));
+    fraction &= one.f - 1;
+
+    if (fraction < unsafe) {
+      *power10 -= dropped;
+      return weed_digits(digits, *length, distance * unit, unsafe, fraction,
+                         one.f, unit);
+    }
+  }
+}
+
+/*
+ * src/number.c:grisu3
+ * buildyourownlisp.com correspondence: none
+ *
+ * Write the shortest digits that read back as the given (positive, finite)
+ * double, so that it equals them times ten to the power of `power10`. This is
+ * Grisu3, from Florian Loitsch's "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers": it works with 64-bit integers alone, and for the
+ * one double in a few hundred where their precision is not enough to be sure
+ * of the result, it returns false instead.
+ *
+ */
+static bool grisu3(double number, char *digits, size_t *length, int *power10) {
+  DiyFp value = diy_fp_of(number);
+  DiyFp lower, upper;
+  find_boundaries(value, &lower, &upper);
+
+  DiyFp power = cached_power(upper.e, power10);
+  return generate_digits(diy_multiply(lower, power),
+                         diy_multiply(diy_normalize(value), power),
+                         diy_multiply(upper, power), digits, length, power10);
+}
+
+/*
+ * src/number.c:search_digits
+ * buildyourownlisp.com correspondence: none
+ *
+ * Find the shortest digits that read back as the given (positive, finite)
+ * double the slow way, by trying `snprintf` with more and more of them, for
+ * when `grisu3` cannot tell.
+ *
+ */
+static size_t search_digits(double number, char *digits, int *power10) {
+  char text[32];
+  for (int precision = 1;; precision++) {
+    snprintf(text, sizeof(text), "%.*e", precision - 1, number);
+    if (strtod(text, NULL) == number || precision == 17) {
+      break;
+    }
+  }
+
+  /* The text is a digit, maybe a point and more digits, then the exponent */
+  size_t length = 0;
+  char *character = text;
+  for (; *character != 'e'; character++) {
+    if (*character != '.') {
+      digits[length++] = *character;
+    }
+  }
+  *power10 = atoi(character + 1) - (int)length + 1;
+  return length;
+}
+
+// Write the digits of an integer, returning how many there are
+static size_t write_integer(uint64_t integer, char *text) {
+  char reversed[20];
+  size_t length = 0;
+  do {
+    reversed[length++] = (char)('0' + integer % 10);
+    integer /= 10;
+  } while (integer > 0);
+
+  for (size_t index = 0; index < length; index++) {
+    text[index] = reversed[length - 1 - index];
+  }
+  return length;
+}
+
+/*
+ * src/number.c:write_digits
+ * buildyourownlisp.com correspondence: none
+ *
+ * Lay out digits that are to be multiplied by ten to the power of `power10`.
+ * Numbers whose magnitude is from 1e-4 up to 1e21 are written in full, and the
+ * others with an exponent of at least two digits, as `%g` does.
+ *
+ */
+static size_t write_digits(char const *digits, size_t length, int power10,
+                           char *text) {
+  /* Where the decimal point goes, counting from the first digit */
+  int point = (int)length + power10;
+  size_t written = 0;
+
+  if (power10 >= 0 && point <= 21) {
+    /* An integer, padded with zeros */
+    memcpy(text, digits, length);
+    memset(text + length, '0', (size_t)power10);
+    return length + (size_t)power10;
+  }
+  if (point > 0 && point <= 21) {
+    /* A point in the middle of the digits */
+    memcpy(text, digits, (size_t)point);
+    text[point] = '.';
+    memcpy(text + point + 1, digits + point, length - (size_t)point);
+    return length + 1;
+  }
+  if (point > -4 && point <= 0) {
+    /* Zeros after the point, then the digits */
+    text[written++] = '0';
+    text[written++] = '.';
+    memset(text + written, '0', (size_t)-point);
+    written += (size_t)-point;
+    memcpy(text + written, digits, length);
+    return written + length;
+  }
+
+  /* An exponent: one digit before the point, and the rest after it */
+  text[written++] = digits[0];
+  if (length > 1) {
+    text[written++] = '.';
+    memcpy(text + written, digits + 1, length - 1);
+    written += length - 1;
+  }
+  int exponent = point - 1;
+  text[written++] = 'e';
+  text[written++] = exponent < 0 ? '-' : '+';
+  unsigned magnitude = (unsigned)(exponent < 0 ? -exponent : exponent);
+  if (magnitude < 10) {
+    text[written++] = '0';
+  }
+  return written + write_integer(magnitude, text + written);
+}
+
+/*
+ * src/number.c:format_number
+ * buildyourownlisp.com correspondence: none
+ *
+ * Write a double as text, with the fewest digits that read back as the same
+ * double, and return how many characters that took; the text needs room for
+ * NUMBER_LENGTH of them, and is not null-terminated. Integers of up to 2^53
+ * are written directly; other numbers get their digits from `grisu3`.
+ *
+ */
+size_t format_number(double number, char *text) {
+  if (isnan(number)) {
+    memcpy(text, "nan", 3);
+    return 3;
+  }
+
+  /* Negative zero is not less than zero, so it is written as 0 */
+  size_t written = 0;
+  if (number < 0) {
+    text[written++] = '-';
+    number = -number;
+  }
+  if (isinf(number)) {
+    memcpy(text + written, "inf", 3);
+    return written + 3;
+  }
+
+  if (number < INTEGER_LIMIT && number == (double)(uint64_t)number) {
+    return written + write_integer((uint64_t)number, text + written);
+  }
+
+  char digits[20];
+  size_t length;
+  int power10;
+  if (!grisu3(number, digits, &length, &power10)) {
+    length = search_digits(number, digits, &power10);
+  }
+  return written + write_digits(digits, length, power10, text + written);
+}
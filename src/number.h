@@ -0,0 +1,26 @@
+/*
+ * src/number.h
+ *
+ * Convert number literals in Lye source code, which follow the grammar's
+ * `number` rule (an optional minus sign, some digits, then optionally a dot
+ * and some more digits), to C doubles. The result is always the double nearest
+ * to the literal, the same one `strtod` would give; most literals get there
+ * with integer arithmetic alone, and only the hard cases go to `strtod`.
+ *
+ * Doubles are turned back into text with the fewest digits that read back as
+ * the same double, which `%g` cannot do: it always rounds to six digits.
+ *
+ */
+#ifndef lye_number_h
+#define lye_number_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* The most characters `format_number` writes */
+#define NUMBER_LENGTH 32
+
+bool parse_number(char const *text, size_t length, double *number);
+size_t format_number(double number, char *text);
+
+#endif
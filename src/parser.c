@@ -1,25 +1,41 @@
 #include "parser.h"
 
+#ifdef LYE_MPC_PARSER
+#include "../build/grammar.h"
+#include "number.h"
+
+/* The Parser shared by every evaluation */
+static Parser parser;
+#endif
+
 /*
  * src/parser.c:create_parser
  * buildyourownlisp.com correspondence: main
  *
- * Create an MPC parser. It has one field per grammar rule.
+ * Create the MPC parser, with one field per grammar rule, and define its
+ * rules from the grammar. This is done only once, when the program starts, and
+ * only if the MPC parser is used instead of the reader.
  *
  */
-Parser *create_parser() {
-  Parser *parser = malloc(sizeof(Parser));
-  parser->Number = mpc_new("number");
-  parser->Symbol = mpc_new("symbol");
-  parser->Sexpr = mpc_new("sexpr");
-  parser->Qexpr = mpc_new("qexpr");
-  parser->Expr = mpc_new("expr");
-  parser->Comment = mpc_new("comment");
-  parser->Lye = mpc_new("lye");
-
-  return parser;
+void create_parser(void) {
+#ifdef LYE_MPC_PARSER
+  parser.Number = mpc_new("number");
+  parser.Symbol = mpc_new("symbol");
+  parser.Sexpr = mpc_new("sexpr");
+  parser.Qexpr = mpc_new("qexpr");
+  parser.Expr = mpc_new("expr");
+  parser.Comment = mpc_new("comment");
+  parser.Lye = mpc_new("lye");
+
+  /* Define parsers for our Language */
+  mpca_lang(MPCA_LANG_DEFAULT, GRAMMAR, parser.Number, parser.Symbol,
+            parser.Sexpr, parser.Qexpr, parser.Expr, parser.Comment,
+            parser.Lye);
+#endif
 }
 
+#ifdef LYE_MPC_PARSER
+
 /*
  * src/parser.c:read_number
  * buildyourownlisp.com correspondence: lval_read_num
@@ -30,10 +46,10 @@ Parser *create_parser() {
  *
  */
 static Value *read_number(mpc_ast_t *ast) {
-  errno = 0;
-  double number = strtod(ast->contents, NULL);
-  return errno == ERANGE ? make_error("number outside of valid bounds.")
-                         : make_number(number);
+  double number;
+  return parse_number(ast->contents, strlen(ast->contents), &number)
+             ? make_number(number)
+             : make_error("number outside of valid bounds.");
 }
 
 // Check if the parser should skip the current AST (e.g. parentheses)
@@ -47,14 +63,14 @@ static inline bool skip(mpc_ast_t *ast, size_t index) {
 }
 
 /*
- * src/parser.c:expressionize
+ * src/parser.c:expressionize_node
  * buildyourownlisp.com correspondence: lval_read
  *
- * Recursively convert an Abstract Syntax Tree into a Lye Value. An
- * S-Expression will always be at the root.
+ * Convert a single node of an Abstract Syntax Tree into a Lye Value. Lists
+ * are returned empty, for `expressionize` to fill in.
  *
  */
-static Value *expressionize(mpc_ast_t *ast) {
+static Value *expressionize_node(mpc_ast_t *ast) {
 #define HAS_TAG(some_tag) (strstr(ast->tag, some_tag))
   /* If Symbol or Number return Value of that type */
   if (HAS_TAG("number")) {
@@ -71,37 +87,97 @@ static Value *expressionize(mpc_ast_t *ast) {
   } else if (HAS_TAG("qexpr")) {
     value = make_qexpr();
   }
+#undef HAS_TAG
+
+  return value;
+}
+
+/* A list node of the AST being converted, and how many of its children have
+been converted so far */
+typedef struct Pending {
+  mpc_ast_t *ast;
+  Value *value;
+  size_t index;
+} Pending;
 
-  /* Fill the list with any valid expressions contained within */
-  for (size_t index = 0; index < (size_t)ast->children_num; index++) {
-    if (skip(ast, index)) {
+/*
+ * src/parser.c:expressionize
+ * buildyourownlisp.com correspondence: lval_read
+ *
+ * Convert an Abstract Syntax Tree into a Lye Value. An S-Expression will
+ * always be at the root. Nested lists are converted using an explicit stack
+ * rather than by recursion, so there is no limit to how deeply they may be
+ * nested.
+ *
+ */
+static Value *expressionize(mpc_ast_t *root) {
+  size_t capacity = 16;
+  size_t depth = 0;
+  Pending *pending = malloc(sizeof(Pending) * capacity);
+  Value *value = NULL;
+
+  pending[depth++] = (Pending){root, expressionize_node(root), 0};
+  while (depth > 0) {
+    Pending *top = &pending[depth - 1];
+
+    /* Once a list is complete, add it to the list that contains it */
+    if (top->index == (size_t)top->ast->children_num) {
+      value = top->value;
+      if (--depth > 0) {
+        pending[depth - 1].value =
+            append_value(pending[depth - 1].value, value);
+      }
+      continue;
+    }
+
+    /* Fill the list with any valid expressions contained within */
+    size_t index = top->index++;
+    if (skip(top->ast, index)) {
       continue;
     }
-    value = append_value(value, expressionize(ast->children[index]));
+    mpc_ast_t *child = top->ast->children[index];
+    Value *element = expressionize_node(child);
+    if (strstr(child->tag, "number") || strstr(child->tag, "symbol")) {
+      top->value = append_value(top->value, element);
+      continue;
+    }
+
+    if (depth == capacity) {
+      capacity *= 2;
+      pending = realloc(pending, sizeof(Pending) * capacity);
+    }
+    pending[depth++] = (Pending){child, element, 0};
   }
-#undef HAS_TAG
 
+  free(pending);
   return value;
 }
 
+#endif
+
 /*
  * src/parser.c:parse
  * buildyourownlisp.com correspondence: main
  *
- * Parse an expression according to the rules of Lye, returning its Value
+ * Parse an expression according to the rules of Lye, returning its Value. The
+ * input is `size` characters long, and need not be null-terminated.
  *
  */
-Value *parse(Env *env, Parser *parser, char *input) {
-  /* Define parsers for our Language */
-  mpca_lang_contents(MPCA_LANG_DEFAULT, GRAMMAR_FILE, parser->Number,
-                     parser->Symbol, parser->Sexpr, parser->Qexpr, parser->Expr,
-                     parser->Comment, parser->Lye);
+Value *parse(Env *env, char const *input, size_t size) {
+#ifndef LYE_MPC_PARSER
+  /* A syntax error evaluates to itself */
+  return evaluate(env, read_source(input, size));
+#else
+  /* MPC needs a null-terminated string */
+  char *text = malloc(size + 1);
+  memcpy(text, input, size);
+  text[size] = '\0';
 
   /* Attempt to parse the user input */
   mpc_result_t result;
   Value *value;
 
-  if (mpc_parse("<stdin>", input, parser->Lye, &result)) {
+  if (mpc_parse("<stdin>", text, parser.Lye, &result)) {
     /* On success return the result */
     value = expressionize(result.output);
     value = evaluate(env, value);
@@ -110,22 +186,26 @@ Value *parse(Env *env, Parser *parser, char *input) {
     /* Otherwise return the error */
     ErrorMsg error = mpc_err_string(result.error);
     value = make_error(error);
+    free(error);
     mpc_err_delete(result.error);
   }
 
+  free(text);
   return value;
+#endif
 }
 
 /*
  * src/parser.c:cleanup_parser
  * buildyourownlisp.com correspondence: main
  *
- * Free the memory used by the Parser
+ * Free the memory used by the Parser, at the end of the program.
  *
  */
-void cleanup_parser(Parser *parser) {
+void cleanup_parser(void) {
+#ifdef LYE_MPC_PARSER
   /* Undefine and Delete our Parsers */
-  mpc_cleanup(7, parser->Number, parser->Symbol, parser->Sexpr, parser->Qexpr,
-              parser->Expr, parser->Comment, parser->Lye);
-  free(parser);
+  mpc_cleanup(7, parser.Number, parser.Symbol, parser.Sexpr, parser.Qexpr,
+              parser.Expr, parser.Comment, parser.Lye);
+#endif
 }
@@ -1,8 +1,14 @@
 /*
  * src/parser.h
  *
- * Define the Parser structure, which is coupled with the external dependency
- * MPC, along with functions to create, use and destroy it.
+ * Expose the function that parses and evaluates Lye source code. By default,
+ * source code is read by the hand-written reader (see reader.h).
+ *
+ * Building with -DLYE_MPC_PARSER uses the Parser structure instead, which is
+ * coupled with the external dependency MPC, along with functions to create and
+ * destroy it. There is a single Parser, built from the grammar when the
+ * program starts and used for every evaluation until it ends. The grammar is
+ * embedded in the binary at build time, from grammar.txt.
  *
  */
 #ifndef lye_parser_h
@@ -12,10 +18,10 @@
 #include "../utils/file.h"
 
 #include "eval.h"
+#include "reader.h"
 #include "value.h"
 
-#define GRAMMAR_FILE "./grammar.txt"
-
+#ifdef LYE_MPC_PARSER
 /* Define the Parser struct; it should have one `mpc_parser_t` for each
 rule in the grammar */
 typedef struct Parser {
@@ -27,9 +33,10 @@ typedef struct Parser {
   mpc_parser_t *Comment;
   mpc_parser_t *Lye;
 } Parser;
+#endif
 
-Parser *create_parser();
-Value *parse(Env *env, Parser *parser, char *input);
-void cleanup_parser(Parser *parser);
+void create_parser(void);
+Value *parse(Env *env, char const *input, size_t size);
+void cleanup_parser(void);
 
 #endif
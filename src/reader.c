@@ -0,0 +1,523 @@
+#include "reader.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "number.h"
+#include "symbol.h"
+
+// Check if a character may appear in a symbol
+static inline bool is_symbol_char(char c) {
+  return isalnum((unsigned char)c) ||
+         (c != '\0' && strchr("_+-*/%^\\=<>!&", c));
+}
+
+// Check if a character is a decimal digit
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+/*
+ * src/reader.c:scan_number
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the length of the number at the start of the text, which ends at
+ * `end`, or zero if there is none. Like the `number` rule of the grammar, this
+ * is an optional minus sign, some digits, then optionally a dot and some more
+ * digits.
+ *
+ */
+static size_t scan_number(char const *text, char const *end) {
+  size_t size = (size_t)(end - text);
+  size_t length = size > 0 && text[0] == '-' ? 1 : 0;
+  if (length == size || !is_digit(text[length])) {
+    return 0;
+  }
+  while (length < size && is_digit(text[length])) {
+    length++;
+  }
+  if (length + 1 < size && text[length] == '.' &&
+      is_digit(text[length + 1])) {
+    length++;
+    while (length < size && is_digit(text[length])) {
+      length++;
+    }
+  }
+  return length;
+}
+
+/*
+ * src/reader.c:read_number
+ * buildyourownlisp.com correspondence: lval_read_num
+ *
+ * Convert a number of the given length in the source code to a Lye Value. We
+ * check that the number can actually be represented as a C double, which is
+ * the internal representation of Lye numbers.
+ *
+ */
+static Value *read_number(char const *text, size_t length) {
+  double number;
+  return parse_number(text, length, &number)
+             ? make_number(number)
+             : make_error("number outside of valid bounds.");
+}
+
+/* A place in the source code, counting from 1 */
+typedef struct Position {
+  unsigned long line;
+  unsigned long column;
+} Position;
+
+/*
+ * src/reader.c:syntax_error
+ * buildyourownlisp.com correspondence: none
+ *
+ * Make the error for source code that does not follow the grammar, saying
+ * where the reader got stuck and what it expected to find there.
+ *
+ */
+static Value *syntax_error(char const *source, char const *at,
+                           char const *end, char const *expected,
+                           Position start) {
+  unsigned long line = start.line;
+  unsigned long column = start.column;
+  for (char const *position = source; position < at; position++) {
+    if (*position == '\n') {
+      line++;
+      column = 1;
+    } else {
+      column++;
+    }
+  }
+
+  if (at == end) {
+    return make_error("<stdin>:%lu:%lu: error: expected %s at end of input",
+                      line, column, expected);
+  }
+  return make_error("<stdin>:%lu:%lu: error: expected %s at '%c'", line,
+                    column, expected, *at);
+}
+
+/* A list whose elements are being read, and the character that closes it */
+typedef struct Open {
+  Value *list;
+  char close;
+} Open;
+
+/*
+ * src/reader.c:read_atom
+ * buildyourownlisp.com correspondence: lval_read
+ *
+ * Append the numbers and symbols that make up an atom to a list. Usually an
+ * atom is a single number or symbol, but the grammar also splits e.g. `12abc`
+ * into a number and a symbol. Return where the atom stops following the
+ * grammar, or NULL if it does to the end.
+ *
+ */
+static char const *read_atom(Value **list, char const *text, char const *end) {
+  while (text < end) {
+    /* A number, or failing that a symbol */
+    size_t length = scan_number(text, end);
+    if (length > 0) {
+      *list = append_value(*list, read_number(text, length));
+      text += length;
+      continue;
+    }
+    while (text + length < end && is_symbol_char(text[length])) {
+      length++;
+    }
+    if (length == 0) {
+      return text;
+    }
+    *list = append_value(*list,
+                         make_interned_symbol(intern_length(text, length)));
+    text += length;
+  }
+  return NULL;
+}
+
+/*
+ * src/reader.c:read_text
+ * buildyourownlisp.com correspondence: lval_read
+ *
+ * Read Lye source code into a Value. An S-Expression, holding every
+ * expression in the source, will always be at the root. Lists that are still
+ * open are kept on an explicit stack, so there is no limit to how deeply they
+ * may be nested. If the source does not follow the grammar, return an error
+ * instead, saying where it went wrong: positions are counted from `origin`,
+ * which is at `start`, and which the source is part of.
+ *
+ * The source ends at `size` characters, and needs no null terminator: names
+ * and numbers are read straight from it, so it can be a file mapped into
+ * memory. It is split into tokens by the given Tokenizer (see tokenizer.h),
+ * which is restarted on it.
+ *
+ */
+static Value *read_text(Tokenizer *tokenizer, char const *origin,
+                        char const *source, size_t size, Position start) {
+  size_t capacity = 16;
+  size_t depth = 0;
+  Open *open = malloc(sizeof(Open) * capacity);
+  char const *end = source + size;
+  Value *error = NULL;
+  Token token;
+
+  start_tokenizer(tokenizer, source, size);
+  open[depth++] = (Open){make_sexpr(), '\0'};
+  while (next_token(tokenizer, &token)) {
+    char const *text = source + token.start;
+    Open *top = &open[depth - 1];
+
+    /* Comments, which run until the end of the line, only go between the
+    expressions at the root */
+    if (*text == ';' && depth == 1) {
+      char const *newline = memchr(text, '\n', (size_t)(end - text));
+      skip_tokens(tokenizer, newline ? (size_t)(newline - source) : size);
+      continue;
+    }
+
+    /* The start of a list */
+    if (*text == '(' || *text == '{') {
+      if (depth == capacity) {
+        capacity *= 2;
+        open = realloc(open, sizeof(Open) * capacity);
+      }
+      open[depth++] = *text == '(' ? (Open){make_sexpr(), ')'}
+                                   : (Open){make_qexpr(), '}'};
+      continue;
+    }
+
+    /* The end of a list, which is added to the list that contains it */
+    if (*text == top->close) {
+      depth--;
+      open[depth - 1].list = append_value(open[depth - 1].list, top->list);
+      continue;
+    }
+
+    /* Anything else that is not allowed here: a misplaced delimiter, or an
+    atom that is not made of numbers and symbols */
+    if (strchr("(){};", *text) == NULL) {
+      text = read_atom(&top->list, text, text + token.length);
+      if (text == NULL) {
+        continue;
+      }
+    }
+    if (depth == 1) {
+      error = syntax_error(origin, text, end,
+                           "an expression, comment or end of input", start);
+    } else {
+      error = syntax_error(origin, text, end,
+                           top->close == ')' ? "an expression or ')'"
+                                             : "an expression or '}'",
+                           start);
+    }
+    break;
+  }
+
+  /* The end of the source must not be inside a list */
+  if (!error && depth > 1) {
+    error = syntax_error(origin, end, end,
+                         open[depth - 1].close == ')' ? "')'" : "'}'", start);
+  }
+
+  /* On error, drop whatever was read */
+  if (error) {
+    while (depth > 0) {
+      delete_value(open[--depth].list);
+    }
+    free(open);
+    return error;
+  }
+
+  Value *root = open[0].list;
+  free(open);
+  return root;
+}
+
+/*
+ * src/reader.c:read_source
+ * buildyourownlisp.com correspondence: lval_read
+ *
+ * Read the given number of characters of Lye source code into a Value (see
+ * `read_text`).
+ *
+ */
+Value *read_source(char const *source, size_t size) {
+  Tokenizer *tokenizer = malloc(sizeof(Tokenizer));
+  Value *value = read_text(tokenizer, source, source, size, (Position){1, 1});
+  free(tokenizer);
+  return value;
+}
+
+// =====================
+// Reading in parallel
+// =====================
+
+/* How many threads `read_parallel` uses */
+static size_t thread_count = LYE_THREADS;
+
+/*
+ * src/reader.c:configure_reader
+ * buildyourownlisp.com correspondence: none
+ *
+ * Read the number of threads for `read_parallel` from the environment variable
+ * LYE_THREADS, keeping the default if it is missing or invalid. Zero means one
+ * thread per processor.
+ *
+ */
+void configure_reader(void) {
+  char *setting = getenv("LYE_THREADS");
+  char *end;
+
+  if (setting) {
+    unsigned long threads = strtoul(setting, &end, 10);
+    if (*end == '\0' && end != setting) {
+      thread_count = threads;
+    }
+  }
+  if (thread_count == 0) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = processors > 0 ? (size_t)processors : 1;
+  }
+}
+
+/*
+ * src/reader.c:split_source
+ * buildyourownlisp.com correspondence: none
+ *
+ * Split source code into at most `parts` chunks of about the same size, made
+ * of whole top-level expressions, by finding whitespace outside of any list
+ * and comment. Fill `bounds` with the offsets where the chunks start, then
+ * the size of the source, and return how many chunks there are.
+ *
+ */
+static size_t split_source(char const *source, size_t size, size_t parts,
+                           size_t *bounds) {
+  size_t count = 0;
+  size_t depth = 0;
+
+  bounds[count++] = 0;
+  for (size_t index = 0; index < size && count < parts; index++) {
+    char character = source[index];
+    if (character == ';' && depth == 0) {
+      char const *newline = memchr(source + index, '\n', size - index);
+      index = newline ? (size_t)(newline - source) : size;
+    } else if (character == '(' || character == '{') {
+      depth++;
+    } else if ((character == ')' || character == '}') && depth > 0) {
+      depth--;
+    } else if (depth == 0 && isspace((unsigned char)character) &&
+               index >= size / parts * count) {
+      bounds[count++] = index;
+    }
+  }
+
+  bounds[count] = size;
+  return count;
+}
+
+/* A chunk of source code read by a thread, into a Heap of its own */
+typedef struct Chunk {
+  char const *origin;
+  char const *text;
+  size_t size;
+  Heap *heap;
+  Value *value;
+} Chunk;
+
+// Read a chunk of source code, as the body of a thread
+static void *read_chunk(void *argument) {
+  Chunk *chunk = argument;
+  Tokenizer *tokenizer = malloc(sizeof(Tokenizer));
+  enter_heap(chunk->heap);
+  chunk->value = read_text(tokenizer, chunk->origin, chunk->text, chunk->size,
+                           (Position){1, 1});
+  leave_heap();
+  free(tokenizer);
+  return NULL;
+}
+
+/*
+ * src/reader.c:read_parallel
+ * buildyourownlisp.com correspondence: lval_read
+ *
+ * Read a string of Lye source code into a Value, like `read_source`, but on
+ * several threads at once (see `configure_reader`). The source is split
+ * between top-level expressions, each thread reads a chunk into its own Heap,
+ * and the results are put back together in order. If any chunk does not
+ * follow the grammar, the first such error is returned.
+ *
+ */
+Value *read_parallel(char const *source, size_t size) {
+  if (thread_count == 0) {
+    configure_reader();
+  }
+  size_t *bounds = malloc(sizeof(size_t) * (thread_count + 1));
+  size_t parts = split_source(source, size, thread_count, bounds);
+  Chunk *chunks = malloc(sizeof(Chunk) * parts);
+  pthread_t *threads = malloc(sizeof(pthread_t) * parts);
+  bool *started = malloc(sizeof(bool) * parts);
+
+  /* The first chunk is read by this thread, while the others run */
+  init_tokenizer();
+  share_symbols(true);
+  for (size_t index = parts; index > 0; index--) {
+    Chunk *chunk = &chunks[index - 1];
+    *chunk = (Chunk){source, source + bounds[index - 1],
+                     bounds[index] - bounds[index - 1], make_heap(), NULL};
+    started[index - 1] =
+        index > 1 &&
+        pthread_create(&threads[index - 1], NULL, read_chunk, chunk) == 0;
+    if (!started[index - 1]) {
+      read_chunk(chunk);
+    }
+  }
+  for (size_t index = 0; index < parts; index++) {
+    if (started[index]) {
+      pthread_join(threads[index], NULL);
+    }
+    merge_heap(chunks[index].heap);
+  }
+  share_symbols(false);
+
+  /* Join the chunks back together, unless one of them is an error */
+  Value *value = chunks[0].value;
+  for (size_t index = 1; index < parts; index++) {
+    if (IS_ERROR(value)) {
+      delete_value(chunks[index].value);
+    } else if (IS_ERROR(chunks[index].value)) {
+      delete_value(value);
+      value = chunks[index].value;
+    } else {
+      value = join_values(value, chunks[index].value);
+    }
+  }
+
+  free(bounds);
+  free(chunks);
+  free(threads);
+  free(started);
+  return value;
+}
+
+// ==================
+// Streaming the code
+// ==================
+
+/*
+ * src/reader.c:make_stream
+ * buildyourownlisp.com correspondence: none
+ *
+ * Create a Stream that reads Lye source code from an open file.
+ *
+ */
+Stream *make_stream(FILE *file) {
+  Stream *stream = malloc(sizeof(Stream));
+  stream->file = file;
+  stream->text = NULL;
+  stream->length = 0;
+  stream->capacity = 0;
+  stream->line = 1;
+  stream->column = 1;
+  stream->tokenizer = malloc(sizeof(Tokenizer));
+  return stream;
+}
+
+/*
+ * src/reader.c:delete_stream
+ * buildyourownlisp.com correspondence: none
+ *
+ * Free the memory used by a Stream. The file is left open.
+ *
+ */
+void delete_stream(Stream *stream) {
+  free(stream->text);
+  free(stream->tokenizer);
+  free(stream);
+}
+
+// Look at the next character of a Stream without consuming it
+static inline int peek(Stream *stream) {
+  int next = getc(stream->file);
+  if (next != EOF) {
+    ungetc(next, stream->file);
+  }
+  return next;
+}
+
+// Consume the next character of a Stream, keeping track of where it is
+static inline int advance(Stream *stream) {
+  int next = getc(stream->file);
+  if (next == '\n') {
+    stream->line++;
+    stream->column = 1;
+  } else if (next != EOF) {
+    stream->column++;
+  }
+  return next;
+}
+
+// Add a character to the text being collected by a Stream
+static inline void keep(Stream *stream, char character) {
+  if (stream->length == stream->capacity) {
+    stream->capacity = stream->capacity ? stream->capacity * 2 : 256;
+    stream->text = realloc(stream->text, stream->capacity);
+  }
+  stream->text[stream->length++] = character;
+}
+
+// Check if a character ends an atom at the root of the source
+static inline bool ends_atom(int character) {
+  return isspace(character) || strchr("(){};", character);
+}
+
+/*
+ * src/reader.c:read_next
+ * buildyourownlisp.com correspondence: none
+ *
+ * Read the next top-level expression from a Stream. The result is the same as
+ * if its text were read with `read_source`: an S-Expression holding it (or, for
+ * text such as `12abc`, the few expressions it is made of), or an error. When
+ * there is nothing left but whitespace and comments, return NULL.
+ *
+ * Only the text of this one expression is held in memory at a time, so the
+ * Stream can read code of any size.
+ *
+ */
+Value *read_next(Stream *stream) {
+  /* Skip whitespace and comments between expressions */
+  int next;
+  while ((next = peek(stream)) != EOF) {
+    if (next == ';') {
+      while ((next = peek(stream)) != EOF && next != '\n') {
+        advance(stream);
+      }
+    } else if (isspace(next)) {
+      advance(stream);
+    } else {
+      break;
+    }
+  }
+  if (next == EOF) {
+    return NULL;
+  }
+
+  /* Collect the text up to the end of the expression: the bracket closing the
+  one it opens with, or else the end of the atom. A closing bracket with no
+  opening one is collected alone, for `read_text` to complain about */
+  Position start = {stream->line, stream->column};
+  size_t depth = 0;
+  stream->length = 0;
+  while ((next = peek(stream)) != EOF) {
+    if (depth == 0 && stream->length > 0 && ends_atom(next)) {
+      break;
+    }
+    keep(stream, (char)advance(stream));
+    if (next == '(' || next == '{') {
+      depth++;
+    } else if ((next == ')' || next == '}') && (depth == 0 || --depth == 0)) {
+      break;
+    }
+  }
+  return read_text(stream->tokenizer, stream->text, stream->text,
+                   stream->length, start);
+}
@@ -0,0 +1,49 @@
+/*
+ * src/reader.h
+ *
+ * Expose the reader, which turns Lye source code into Values in a single pass
+ * over the text. It recognises the same grammar as grammar.txt, which is
+ * what the MPC parser (built with -DLYE_MPC_PARSER) uses.
+ *
+ * Syntax errors are reported as error Values, with the line and column where
+ * the reader got stuck.
+ *
+ * Source code can also be read from a Stream, one top-level expression at a
+ * time, so that it never needs to be held in memory all at once; or, when it
+ * is all in memory, on several threads at once.
+ *
+ */
+#ifndef lye_reader_h
+#define lye_reader_h
+
+#include "tokenizer.h"
+#include "value.h"
+
+/* Default for the number of threads that read source code in parallel, which
+may also be set at runtime from the environment variable of the same name. Zero
+means one per processor */
+#ifndef LYE_THREADS
+#define LYE_THREADS 0
+#endif
+
+/* Define a file being read one top-level expression at a time. `text` holds
+the expression currently being read, and `line` and `column` tell where the
+Stream is in the file. The same Tokenizer splits every expression */
+typedef struct Stream {
+  FILE *file;
+  char *text;
+  size_t length;
+  size_t capacity;
+  unsigned long line;
+  unsigned long column;
+  Tokenizer *tokenizer;
+} Stream;
+
+void configure_reader(void);
+Value *read_source(char const *source, size_t size);
+Value *read_parallel(char const *source, size_t size);
+Stream *make_stream(FILE *file);
+Value *read_next(Stream *stream);
+void delete_stream(Stream *stream);
+
+#endif
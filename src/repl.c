@@ -1,19 +1,93 @@
 #include "repl.h"
 
+#include "gc.h"
+
 /*
  * src/repl.c:run_string
  * buildyourownlisp.com correspondence: main
  *
- * Execute a string of Lye code. This function abstracts away the origin of the
- * source code: a file, REPL entry or string passed as a command-line argument.
+ * Execute a string of Lye code, `size` characters long. This function
+ * abstracts away the origin of the source code: a file, REPL entry or string
+ * passed as a command-line argument.
  *
  */
-void run_string(Env *env, char *source) {
-  Parser *parser = create_parser();
-  Value *value = parse(env, parser, source);
+void run_string(Env *env, char const *source, size_t size) {
+  Value *value = parse(env, source, size);
   println_value(value);
   delete_value(value);
-  cleanup_parser(parser);
+
+  /* Nothing but the Env holds Values now, so the garbage collector may run */
+  collect_garbage(env);
+}
+
+/*
+ * src/repl.c:run_forms
+ * buildyourownlisp.com correspondence: none
+ *
+ * Evaluate each of a list of top-level expressions on its own, in order, then
+ * drop them. Errors are always printed; other values only if `print` is set.
+ * If reading the expressions failed, just print the error. The garbage
+ * collector takes a step after each expression.
+ *
+ */
+static void run_forms(Env *env, Value *forms, bool print) {
+  if (IS_ERROR(forms)) {
+    println_value(forms);
+    delete_value(forms);
+    return;
+  }
+
+  for (size_t index = 0; index < count(forms); index++) {
+    Value *value = evaluate(env, copy_value(element_at(forms, index)));
+    if (print || IS_ERROR(value)) {
+      println_value(value);
+    }
+    delete_value(value);
+
+    /* Nothing but the Env and the forms still to run hold Values now, so the
+    garbage collector may take a step. The forms are not in the Env, so they
+    must be marked by hand */
+    shade_value(forms);
+    collect_garbage(env);
+  }
+  delete_value(forms);
+}
+
+/*
+ * src/repl.c:run_stream
+ * buildyourownlisp.com correspondence: none
+ *
+ * Execute Lye code from a file, one top-level expression at a time: each is
+ * read, evaluated and dropped before the next one is read, so memory use does
+ * not grow with the size of the file. Errors are always printed; other values
+ * only if `print` is set.
+ *
+ * Unlike `run_string`, this does not treat the whole code as one expression:
+ * `+ 1 2` is three expressions here, not a call to `+`.
+ *
+ */
+void run_stream(Env *env, FILE *file, bool print) {
+  Stream *stream = make_stream(file);
+  Value *forms;
+
+  while ((forms = read_next(stream))) {
+    run_forms(env, forms, print);
+  }
+
+  delete_stream(stream);
+}
+
+/*
+ * src/repl.c:run_parallel
+ * buildyourownlisp.com correspondence: none
+ *
+ * Execute a string of Lye code, `size` characters long, which is read on
+ * several threads at once (see `read_parallel`). The top-level expressions are
+ * then evaluated in order, like `run_stream` does.
+ *
+ */
+void run_parallel(Env *env, char const *source, size_t size, bool print) {
+  run_forms(env, read_parallel(source, size), print);
 }
 
 /*
@@ -32,7 +106,7 @@ void repl(Env *env) {
       return;
     }
     add_history(input);
-    run_string(env, input);
+    run_string(env, input, strlen(input));
     free(input);
   }
 }
@@ -2,7 +2,9 @@
  * src/repl.h
  *
  * Define the Read-Eval-Print Loop and expose `run_string`, the function that
- * takes in source code and runs it.
+ * takes in source code and runs it, along with `run_stream` and
+ * `run_parallel`, which do the same for code read from a file piece by piece or
+ * on several threads.
  *
  */
 #ifndef lye_repl_h
@@ -33,7 +35,9 @@ void add_history(char *unused) {}
 
 #include "parser.h"
 
-void run_string(Env *env, char *source);
+void run_string(Env *env, char const *source, size_t size);
+void run_stream(Env *env, FILE *file, bool print);
+void run_parallel(Env *env, char const *source, size_t size, bool print);
 void repl(Env *env);
 
 #endif
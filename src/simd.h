@@ -0,0 +1,26 @@
+/*
+ * src/simd.h
+ *
+ * Decide whether Lye uses SIMD instructions, as the tokenizer and vectors do.
+ * They are used on x86-64, unless -DLYE_NO_SIMD is given. Every such CPU has
+ * SSE2, while AVX2 is only used when the CPU running the program has it.
+ *
+ */
+#ifndef lye_simd_h
+#define lye_simd_h
+
+#include <stdbool.h>
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(LYE_NO_SIMD)
+#define LYE_SIMD
+
+#include <immintrin.h>
+
+// Check if the CPU running the program has AVX2 instructions
+static inline bool has_avx2(void) {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#endif
@@ -0,0 +1,265 @@
+// Needed for posix_memalign
+#define _POSIX_C_SOURCE 200112L
+
+#include "slab.h"
+
+#include <stdint.h>
+
+#ifndef LYE_PLAIN_MALLOC
+
+/*
+ * src/slab.c:stride
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the distance between consecutive objects in a chunk: the object size
+ * rounded up so that every object is suitably aligned for pointers and doubles.
+ *
+ */
+static inline size_t stride(Slab *slab) {
+  size_t alignment = sizeof(double) > sizeof(void *) ? sizeof(double)
+                                                      : sizeof(void *);
+  return (slab->object_size + alignment - 1) / alignment * alignment;
+}
+
+// The objects of a chunk start after its header, at the first aligned offset
+static inline char *first_object(Slab *slab, SlabChunk *chunk) {
+  size_t step = stride(slab);
+  size_t header = sizeof(SlabChunk) + chunk->capacity;
+  return (char *)chunk + (header + step - 1) / step * step;
+}
+
+// Find the chunk that an object was carved from
+static inline SlabChunk *chunk_of(void *object) {
+  return (SlabChunk *)((uintptr_t)object & ~(uintptr_t)(SLAB_CHUNK_BYTES - 1));
+}
+
+// Find the position of an object within its chunk
+static inline size_t index_of(Slab *slab, SlabChunk *chunk, void *object) {
+  return (size_t)((char *)object - first_object(slab, chunk)) / stride(slab);
+}
+
+/*
+ * src/slab.c:grow
+ * buildyourownlisp.com correspondence: none
+ *
+ * Request a new chunk from the system and thread all of its objects onto the
+ * Slab's free list.
+ *
+ */
+static void grow(Slab *slab) {
+  void *memory;
+  if (posix_memalign(&memory, SLAB_CHUNK_BYTES, SLAB_CHUNK_BYTES) != 0) {
+    abort();
+  }
+
+  /* Each object costs its stride plus one byte of the `in_use` array; one
+  extra stride is kept aside for the header to be rounded up */
+  size_t step = stride(slab);
+  SlabChunk *chunk = memory;
+  chunk->capacity = (SLAB_CHUNK_BYTES - sizeof(SlabChunk) - step) / (step + 1);
+  chunk->next = slab->chunks;
+  slab->chunks = chunk;
+
+  /* Push objects in reverse so they are handed out in address order */
+  char *objects = first_object(slab, chunk);
+  for (size_t index = chunk->capacity; index > 0; index--) {
+    chunk->in_use[index - 1] = false;
+    SlabObject *object = (SlabObject *)(objects + step * (index - 1));
+    object->next = slab->free_list;
+    slab->free_list = object;
+  }
+}
+
+/*
+ * src/slab.c:slab_alloc
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return memory for one object, reusing a freed one if there is any.
+ *
+ */
+void *slab_alloc(Slab *slab) {
+  if (slab->free_list == NULL) {
+    grow(slab);
+  }
+  SlabObject *object = slab->free_list;
+  slab->free_list = object->next;
+
+  SlabChunk *chunk = chunk_of(object);
+  chunk->in_use[index_of(slab, chunk, object)] = true;
+  slab->live++;
+  return object;
+}
+
+/*
+ * src/slab.c:slab_free
+ * buildyourownlisp.com correspondence: none
+ *
+ * Give an object back to its Slab. The memory is not returned to the system,
+ * but kept around for the next allocation.
+ *
+ */
+void slab_free(Slab *slab, void *object) {
+  SlabChunk *chunk = chunk_of(object);
+  chunk->in_use[index_of(slab, chunk, object)] = false;
+  slab->live--;
+
+  SlabObject *freed = object;
+  freed->next = slab->free_list;
+  slab->free_list = freed;
+}
+
+/*
+ * src/slab.c:slab_walk_begin
+ * buildyourownlisp.com correspondence: none
+ *
+ * Start walking over the objects in use. Objects may be allocated and freed
+ * while the walk is going on; the walk will not return freed objects, and may
+ * or may not return the ones allocated after it began.
+ *
+ */
+void slab_walk_begin(Slab *slab) {
+  slab->walk_chunk = slab->chunks;
+  slab->walk_index = 0;
+}
+
+/*
+ * src/slab.c:slab_walk_next
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the next object in use, or NULL once the walk is over.
+ *
+ */
+void *slab_walk_next(Slab *slab) {
+  while (slab->walk_chunk) {
+    SlabChunk *chunk = slab->walk_chunk;
+    while (slab->walk_index < chunk->capacity) {
+      size_t index = slab->walk_index++;
+      if (chunk->in_use[index]) {
+        return first_object(slab, chunk) + stride(slab) * index;
+      }
+    }
+    slab->walk_chunk = chunk->next;
+    slab->walk_index = 0;
+  }
+  return NULL;
+}
+
+/*
+ * src/slab.c:slab_merge
+ * buildyourownlisp.com correspondence: none
+ *
+ * Move every chunk of a Slab, with the objects allocated from it, into another
+ * Slab of the same object size, leaving the first one empty. Slabs are not
+ * thread-safe, so each thread that allocates needs its own; this is how their
+ * objects end up in a single Slab afterwards.
+ *
+ */
+void slab_merge(Slab *into, Slab *from) {
+  if (from->chunks) {
+    SlabChunk *last = from->chunks;
+    while (last->next) {
+      last = last->next;
+    }
+    last->next = into->chunks;
+    into->chunks = from->chunks;
+  }
+  if (from->free_list) {
+    SlabObject *last = from->free_list;
+    while (last->next) {
+      last = last->next;
+    }
+    last->next = into->free_list;
+    into->free_list = from->free_list;
+  }
+  into->live += from->live;
+
+  from->chunks = NULL;
+  from->free_list = NULL;
+  from->walk_chunk = NULL;
+  from->live = 0;
+}
+
+/*
+ * src/slab.c:slab_release
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return all the chunks of a Slab to the system, at the end of the program.
+ * Any object still allocated from it becomes invalid.
+ *
+ */
+void slab_release(Slab *slab) {
+  while (slab->chunks) {
+    SlabChunk *next = slab->chunks->next;
+    free(slab->chunks);
+    slab->chunks = next;
+  }
+  slab->free_list = NULL;
+  slab->walk_chunk = NULL;
+  slab->live = 0;
+}
+
+#else
+
+/* Plain malloc versions, for sanitizer builds */
+void *slab_alloc(Slab *slab) {
+  SlabHeader *header = malloc(sizeof(SlabHeader) + slab->object_size);
+  header->previous = NULL;
+  header->next = slab->objects;
+  if (slab->objects) {
+    slab->objects->previous = header;
+  }
+  slab->objects = header;
+  slab->live++;
+  return header + 1;
+}
+
+void slab_free(Slab *slab, void *object) {
+  SlabHeader *header = (SlabHeader *)object - 1;
+  if (header->previous) {
+    header->previous->next = header->next;
+  } else {
+    slab->objects = header->next;
+  }
+  if (header->next) {
+    header->next->previous = header->previous;
+  }
+  if (slab->walk_next == header) {
+    slab->walk_next = header->next;
+  }
+  slab->live--;
+  free(header);
+}
+
+void slab_walk_begin(Slab *slab) { slab->walk_next = slab->objects; }
+
+void *slab_walk_next(Slab *slab) {
+  SlabHeader *header = slab->walk_next;
+  if (header == NULL) {
+    return NULL;
+  }
+  slab->walk_next = header->next;
+  return header + 1;
+}
+
+void slab_merge(Slab *into, Slab *from) {
+  if (from->objects) {
+    SlabHeader *last = from->objects;
+    while (last->next) {
+      last = last->next;
+    }
+    last->next = into->objects;
+    if (into->objects) {
+      into->objects->previous = last;
+    }
+    into->objects = from->objects;
+  }
+  into->live += from->live;
+
+  from->objects = NULL;
+  from->walk_next = NULL;
+  from->live = 0;
+}
+
+void slab_release(__attribute__((unused)) Slab *slab) {}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * src/slab.h
+ *
+ * Define a slab allocator for the small, fixed-size structs that the
+ * interpreter creates and destroys constantly (Values and Functions). Each
+ * Slab hands out objects of a single size, carved from big chunks, and keeps
+ * freed objects in a free list for reuse. A Slab can also walk over all of its
+ * objects in use, which is what the garbage collector sweeps.
+ *
+ * Compiling with -DLYE_PLAIN_MALLOC turns every slab operation into a plain
+ * malloc/free, so that AddressSanitizer can track each object individually.
+ *
+ */
+#ifndef lye_slab_h
+#define lye_slab_h
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifndef LYE_PLAIN_MALLOC
+
+/* Size of each chunk requested from the system. Chunks are aligned to their
+size, so the chunk of an object can be found from its address alone */
+#define SLAB_CHUNK_BYTES 16384
+
+/* Declare the chunk struct. Objects follow it in memory; `in_use` tells which
+of them are currently allocated. Chunks are kept in a list so they can be
+walked and released at the end of the program */
+typedef struct SlabChunk {
+  struct SlabChunk *next;
+  size_t capacity;
+  bool in_use[];
+} SlabChunk;
+
+/* Declare a free object; while in the free list its memory is reused to
+point to the next free object */
+typedef struct SlabObject {
+  struct SlabObject *next;
+} SlabObject;
+
+/* Define the Slab struct. The `walk_` fields are the cursor of an ongoing
+walk over the objects in use */
+typedef struct Slab {
+  size_t object_size;
+  size_t live;
+  SlabChunk *chunks;
+  SlabObject *free_list;
+  SlabChunk *walk_chunk;
+  size_t walk_index;
+} Slab;
+
+/* Static initializer for a Slab of objects of the given type */
+#define SLAB_FOR(type)                                                         \
+  { sizeof(type) < sizeof(SlabObject) ? sizeof(SlabObject) : sizeof(type),     \
+    0, NULL, NULL, NULL, 0 }
+
+#else
+
+/* With plain malloc, each object is preceded by a header linking it to the
+other objects in use, so they can still be walked */
+typedef struct SlabHeader {
+  struct SlabHeader *previous;
+  struct SlabHeader *next;
+} SlabHeader;
+
+typedef struct Slab {
+  size_t object_size;
+  size_t live;
+  SlabHeader *objects;
+  SlabHeader *walk_next;
+} Slab;
+
+#define SLAB_FOR(type) {sizeof(type), 0, NULL, NULL}
+
+#endif
+
+void *slab_alloc(Slab *slab);
+void slab_free(Slab *slab, void *object);
+void slab_walk_begin(Slab *slab);
+void *slab_walk_next(Slab *slab);
+void slab_merge(Slab *into, Slab *from);
+void slab_release(Slab *slab);
+
+#endif
@@ -0,0 +1,149 @@
+#include "symbol.h"
+
+#include <pthread.h>
+
+/* The table is open-addressed with linear probing; its capacity is always a
+power of two, and it is kept at most half full */
+static SymbolInfo **slots = NULL;
+static size_t capacity = 0;
+static size_t interned_count = 0;
+
+/* While several threads may intern names, the table is guarded by a lock */
+static bool shared = false;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * src/symbol.c:hash_string
+ * buildyourownlisp.com correspondence: none
+ *
+ * Compute the FNV-1a hash of the first `length` characters of a string.
+ *
+ */
+static size_t hash_string(char const *string, size_t length) {
+  uint64_t hash = 14695981039346656037u;
+  for (size_t index = 0; index < length; index++) {
+    hash ^= (unsigned char)string[index];
+    hash *= 1099511628211u;
+  }
+  return (size_t)hash;
+}
+
+/*
+ * src/symbol.c:grow
+ * buildyourownlisp.com correspondence: none
+ *
+ * Double the capacity of the table, moving every interned name to its new
+ * slot. The names themselves do not move, so existing Symbols stay valid.
+ *
+ */
+static void grow(void) {
+  size_t old_capacity = capacity;
+  SymbolInfo **old_slots = slots;
+
+  capacity = capacity ? capacity * 2 : 256;
+  slots = calloc(capacity, sizeof(SymbolInfo *));
+
+  for (size_t index = 0; index < old_capacity; index++) {
+    if (old_slots[index]) {
+      size_t slot = old_slots[index]->hash & (capacity - 1);
+      while (slots[slot]) {
+        slot = (slot + 1) & (capacity - 1);
+      }
+      slots[slot] = old_slots[index];
+    }
+  }
+  free(old_slots);
+}
+
+/*
+ * src/symbol.c:find_or_add
+ * buildyourownlisp.com correspondence: none
+ *
+ * Find the interned name made of the first `length` characters of a string,
+ * adding it to the table if it is not there yet.
+ *
+ */
+static Symbol find_or_add(char const *name, size_t length) {
+  if (2 * (interned_count + 1) > capacity) {
+    grow();
+  }
+
+  size_t hash = hash_string(name, length);
+  size_t slot = hash & (capacity - 1);
+  while (slots[slot]) {
+    if (slots[slot]->hash == hash &&
+        strncmp(slots[slot]->name, name, length) == 0 &&
+        slots[slot]->name[length] == '\0') {
+      return slots[slot]->name;
+    }
+    slot = (slot + 1) & (capacity - 1);
+  }
+
+  SymbolInfo *info = malloc(sizeof(SymbolInfo) + length + 1);
+  info->hash = hash;
+  info->global_slot = 0;
+  info->bound_locally = false;
+  memcpy(info->name, name, length);
+  info->name[length] = '\0';
+  slots[slot] = info;
+  interned_count++;
+  return info->name;
+}
+
+/*
+ * src/symbol.c:intern
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the unique Symbol with the given name, adding it to the table the
+ * first time the name is seen.
+ *
+ */
+Symbol intern(char const *name) { return intern_length(name, strlen(name)); }
+
+/*
+ * src/symbol.c:intern_length
+ * buildyourownlisp.com correspondence: none
+ *
+ * Same as `intern`, for a name made of the first `length` characters of a
+ * string, which need not be null-terminated there. The reader uses this to
+ * intern names straight from the source code.
+ *
+ */
+Symbol intern_length(char const *name, size_t length) {
+  if (shared) {
+    pthread_mutex_lock(&lock);
+  }
+  Symbol symbol = find_or_add(name, length);
+  if (shared) {
+    pthread_mutex_unlock(&lock);
+  }
+  return symbol;
+}
+
+/*
+ * src/symbol.c:share_symbols
+ * buildyourownlisp.com correspondence: none
+ *
+ * Tell the table whether threads other than the main one may intern names
+ * from now on. This must only be called while no other thread is running.
+ *
+ */
+void share_symbols(bool is_shared) { shared = is_shared; }
+
+/*
+ * src/symbol.c:release_symbols
+ * buildyourownlisp.com correspondence: none
+ *
+ * Free every interned name, at the end of the program. Any Symbol still
+ * around becomes invalid.
+ *
+ */
+void release_symbols(void) {
+  for (size_t index = 0; index < capacity; index++) {
+    free(slots[index]);
+  }
+  free(slots);
+  slots = NULL;
+  capacity = 0;
+  interned_count = 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * src/symbol.h
+ *
+ * Define the symbol table, which interns every symbol name the interpreter
+ * sees. Each distinct name is stored exactly once, for the whole life of the
+ * program, so two Symbols have the same name if and only if they are the same
+ * pointer: comparing them never needs `strcmp`, and copying them never needs
+ * `malloc`. Each name also carries some information about it, such as its
+ * hash, computed once when it is interned.
+ *
+ * Interned names must never be modified or freed, except all at once by
+ * `release_symbols` at the end of the program. Only the main thread may intern
+ * names, unless `share_symbols` was told otherwise.
+ *
+ */
+#ifndef lye_symbol_h
+#define lye_symbol_h
+
+#include <stddef.h>
+
+#include "value.h"
+
+/* Define what the table knows about each Symbol. The Symbol itself points to
+`name`, so this can be found from it directly */
+typedef struct SymbolInfo {
+  size_t hash;
+  /* Position of the Symbol's entry in the global Env plus one, or zero if
+  it is not known to be there */
+  size_t global_slot;
+  /* Whether the Symbol was ever bound in an Env other than the global one */
+  bool bound_locally;
+  char name[];
+} SymbolInfo;
+
+// Find the information that the table keeps about a Symbol
+static inline SymbolInfo *symbol_info(Symbol symbol) {
+  return (SymbolInfo *)(symbol - offsetof(SymbolInfo, name));
+}
+
+Symbol intern(char const *name);
+Symbol intern_length(char const *name, size_t length);
+void share_symbols(bool is_shared);
+void release_symbols(void);
+
+#endif
@@ -0,0 +1,265 @@
+#include "tokenizer.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* How many bytes are classified at a time: one bit of a mask each */
+#define BLOCK 64
+
+/* Enumerate the classes of bytes. Atoms are made of any bytes that are neither
+whitespace nor delimiters */
+enum { ATOM, SPACE, DELIMITER };
+
+static unsigned char const CLASSES[256] = {
+    [' '] = SPACE,      ['\t'] = SPACE,     ['\n'] = SPACE,
+    ['\v'] = SPACE,     ['\f'] = SPACE,     ['\r'] = SPACE,
+    ['('] = DELIMITER,  [')'] = DELIMITER,  ['{'] = DELIMITER,
+    ['}'] = DELIMITER,  [';'] = DELIMITER};
+
+/* Define which bytes of a block are whitespace, and which are delimiters */
+typedef struct Masks {
+  uint64_t space;
+  uint64_t delimiter;
+} Masks;
+
+// Return the position of the lowest bit set in a (nonzero) mask
+static inline unsigned lowest_bit(uint64_t mask) {
+#ifdef __GNUC__
+  return (unsigned)__builtin_ctzll(mask);
+#else
+  unsigned index = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+/*
+ * src/tokenizer.c:classify_scalar
+ * buildyourownlisp.com correspondence: none
+ *
+ * Classify the first `length` bytes of a block one by one. The rest of the
+ * block, which may lie past the end of the text, counts as whitespace.
+ *
+ */
+static Masks classify_scalar(char const *block, size_t length) {
+  Masks masks = {length < BLOCK ? ~(uint64_t)0 << length : 0, 0};
+  for (size_t index = 0; index < length; index++) {
+    unsigned char class = CLASSES[(unsigned char)block[index]];
+    masks.space |= (uint64_t)(class == SPACE) << index;
+    masks.delimiter |= (uint64_t)(class == DELIMITER) << index;
+  }
+  return masks;
+}
+
+#ifdef LYE_SIMD
+/*
+ * src/tokenizer.c:classify_sse2
+ * buildyourownlisp.com correspondence: none
+ *
+ * Classify a whole block, 16 bytes at a time. Every x86-64 CPU has SSE2.
+ *
+ */
+static Masks classify_sse2(char const *block) {
+  Masks masks = {0, 0};
+  for (unsigned offset = 0; offset < BLOCK; offset += 16) {
+    __m128i bytes = _mm_loadu_si128((__m128i const *)(block + offset));
+
+    /* Whitespace is ' ', or anything from '\t' to '\r' */
+    __m128i control = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+    __m128i space = _mm_or_si128(
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+        _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control));
+    __m128i delimiter = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('(')),
+                     _mm_cmpeq_epi8(bytes, _mm_set1_epi8(')'))),
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('{')),
+                                  _mm_cmpeq_epi8(bytes, _mm_set1_epi8('}'))),
+                     _mm_cmpeq_epi8(bytes, _mm_set1_epi8(';'))));
+
+    masks.space |= (uint64_t)(uint16_t)_mm_movemask_epi8(space) << offset;
+    masks.delimiter |= (uint64_t)(uint16_t)_mm_movemask_epi8(delimiter)
+                       << offset;
+  }
+  return masks;
+}
+
+/*
+ * src/tokenizer.c:classify_avx2
+ * buildyourownlisp.com correspondence: none
+ *
+ * Classify a whole block, 32 bytes at a time. This is compiled for AVX2 even
+ * if the rest of the program is not, and only called if the CPU has it.
+ *
+ */
+__attribute__((target("avx2"))) static Masks classify_avx2(char const *block) {
+  Masks masks = {0, 0};
+  for (unsigned offset = 0; offset < BLOCK; offset += 32) {
+    __m256i bytes = _mm256_loadu_si256((__m256i const *)(block + offset));
+
+    /* Whitespace is ' ', or anything from '\t' to '\r' */
+    __m256i control = _mm256_sub_epi8(bytes, _mm256_set1_epi8('\t'));
+    __m256i space = _mm256_or_si256(
+        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8(4)),
+                          control));
+    __m256i delimiter = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('(')),
+                        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(')'))),
+        _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('}'))),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(';'))));
+
+    masks.space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(space) << offset;
+    masks.delimiter |= (uint64_t)(uint32_t)_mm256_movemask_epi8(delimiter)
+                       << offset;
+  }
+  return masks;
+}
+#endif
+
+// Classify a whole block, without SIMD
+static Masks classify_block(char const *block) {
+  return classify_scalar(block, BLOCK);
+}
+
+/* How whole blocks are classified on this CPU, chosen on first use */
+static Masks (*classify)(char const *block) = NULL;
+
+/*
+ * src/tokenizer.c:init_tokenizer
+ * buildyourownlisp.com correspondence: none
+ *
+ * Pick the fastest way to classify blocks that this CPU supports. This is
+ * done the first time a Tokenizer is started, but threads that use Tokenizers
+ * at the same time need it to be done beforehand.
+ *
+ */
+void init_tokenizer(void) {
+  classify = classify_block;
+#ifdef LYE_SIMD
+  classify = has_avx2() ? classify_avx2 : classify_sse2;
+#endif
+}
+
+// Add a token to those waiting to be handed out
+static inline void emit(Tokenizer *tokenizer, size_t start, size_t length) {
+  tokenizer->tokens[tokenizer->count++] = (Token){start, length};
+}
+
+/*
+ * src/tokenizer.c:tokenize_block
+ * buildyourownlisp.com correspondence: none
+ *
+ * Classify the next block of the text, and find the tokens that end in it.
+ * Atoms start where a byte that belongs to one follows a byte that does not,
+ * and end the other way around; these edges are found for the whole block at
+ * once, by comparing its mask of atom bytes with the same mask shifted by one.
+ *
+ */
+static void tokenize_block(Tokenizer *tokenizer) {
+  size_t base = tokenizer->position;
+  size_t length =
+      tokenizer->size - base < BLOCK ? tokenizer->size - base : BLOCK;
+  Masks masks = length == BLOCK
+                    ? classify(tokenizer->text + base)
+                    : classify_scalar(tokenizer->text + base, length);
+
+  uint64_t atom = ~(masks.space | masks.delimiter);
+  uint64_t edges = atom ^ ((atom << 1) | (uint64_t)tokenizer->in_atom);
+  uint64_t events = edges | masks.delimiter;
+  while (events) {
+    unsigned index = lowest_bit(events);
+    events &= events - 1;
+
+    /* An atom may end right where a delimiter is, so that comes first */
+    if (edges >> index & 1) {
+      if (atom >> index & 1) {
+        tokenizer->atom_start = base + index;
+      } else {
+        emit(tokenizer, tokenizer->atom_start,
+             base + index - tokenizer->atom_start);
+      }
+    }
+    if (masks.delimiter >> index & 1) {
+      emit(tokenizer, base + index, 1);
+    }
+  }
+
+  tokenizer->in_atom = atom >> (BLOCK - 1) & 1;
+  tokenizer->position = base + length;
+
+  /* The text may end in the middle of an atom */
+  if (tokenizer->position == tokenizer->size && tokenizer->in_atom) {
+    emit(tokenizer, tokenizer->atom_start,
+         tokenizer->size - tokenizer->atom_start);
+    tokenizer->in_atom = false;
+  }
+}
+
+/*
+ * src/tokenizer.c:start_tokenizer
+ * buildyourownlisp.com correspondence: none
+ *
+ * Get a Tokenizer ready to split the given text, which is `size` bytes long.
+ *
+ */
+void start_tokenizer(Tokenizer *tokenizer, char const *text, size_t size) {
+  if (!classify) {
+    init_tokenizer();
+  }
+  tokenizer->text = text;
+  tokenizer->size = size;
+  tokenizer->position = 0;
+  tokenizer->in_atom = false;
+  tokenizer->atom_start = 0;
+  tokenizer->skip_until = 0;
+  tokenizer->count = 0;
+  tokenizer->next = 0;
+}
+
+/*
+ * src/tokenizer.c:next_token
+ * buildyourownlisp.com correspondence: none
+ *
+ * Hand out the next token of the text, finding another batch of them when
+ * needed. Return false if there are none left.
+ *
+ */
+bool next_token(Tokenizer *tokenizer, Token *token) {
+  for (;;) {
+    while (tokenizer->next < tokenizer->count) {
+      *token = tokenizer->tokens[tokenizer->next++];
+      if (token->start >= tokenizer->skip_until) {
+        return true;
+      }
+    }
+    if (tokenizer->position == tokenizer->size) {
+      return false;
+    }
+
+    /* A block adds at most one token per byte, plus one for an atom that
+    started before it and one for an atom that runs to the end of the text */
+    tokenizer->count = 0;
+    tokenizer->next = 0;
+    while (tokenizer->position < tokenizer->size &&
+           tokenizer->count + BLOCK + 2 <= TOKEN_BATCH) {
+      tokenize_block(tokenizer);
+    }
+  }
+}
+
+/*
+ * src/tokenizer.c:skip_tokens
+ * buildyourownlisp.com correspondence: none
+ *
+ * Drop the tokens that start before the given position of the text, such as
+ * those that make up a comment.
+ *
+ */
+void skip_tokens(Tokenizer *tokenizer, size_t offset) {
+  tokenizer->skip_until = offset;
+}
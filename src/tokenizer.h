@@ -0,0 +1,53 @@
+/*
+ * src/tokenizer.h
+ *
+ * Define the tokenizer, which splits Lye source code into tokens for the
+ * reader (see reader.h): each of the delimiters `(`, `)`, `{`, `}` and `;` is
+ * a token, and so is each run of other characters that are not whitespace (an
+ * atom, which the reader splits further into numbers and symbols).
+ *
+ * Bytes are classified many at a time: 32 per instruction with AVX2, when the
+ * CPU running the program has it, or 16 with SSE2. Other machines, and builds
+ * with -DLYE_NO_SIMD, classify them one by one. The tokens are handed out in
+ * batches, so that their index never takes more than a fixed amount of memory.
+ *
+ */
+#ifndef lye_tokenizer_h
+#define lye_tokenizer_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "simd.h"
+
+/* How many tokens the tokenizer finds at a time */
+#define TOKEN_BATCH 1024
+
+/* Define a token, as a slice of the source code */
+typedef struct Token {
+  size_t start;
+  size_t length;
+} Token;
+
+/* Define a tokenizer at work. `position` is how far into the text bytes have
+been classified; tokens found up to there wait in `tokens` until handed out */
+typedef struct Tokenizer {
+  char const *text;
+  size_t size;
+  size_t position;
+  /* Whether an atom is still going at `position`, and where it started */
+  bool in_atom;
+  size_t atom_start;
+  /* Tokens starting before this are dropped (see `skip_tokens`) */
+  size_t skip_until;
+  Token tokens[TOKEN_BATCH];
+  size_t count;
+  size_t next;
+} Tokenizer;
+
+void init_tokenizer(void);
+void start_tokenizer(Tokenizer *tokenizer, char const *text, size_t size);
+bool next_token(Tokenizer *tokenizer, Token *token);
+void skip_tokens(Tokenizer *tokenizer, size_t offset);
+
+#endif
@@ -1,38 +1,161 @@
+// Needed for posix_memalign
+#define _POSIX_C_SOURCE 200112L
+
 #include "value.h"
 
 // Included here and not in header file to avoid circular dependency
 #include "env.h"
+#include "gc.h"
+#include "number.h"
+#include "slab.h"
+#include "symbol.h"
+
+/* Every Value and Function is carved out of the slabs of a Heap. The main
+Heap holds every Value the interpreter works with. Slabs are not thread-safe,
+so other threads allocate from Heaps of their own, which are then merged into
+the main one (see `merge_heap`) */
+struct Heap {
+  Slab values;
+  Slab functions;
+};
+
+static Heap main_heap = {SLAB_FOR(Value), SLAB_FOR(Function)};
+static __thread Heap *current_heap = &main_heap;
+
+/* Values whose last reference is gone, waiting for `delete_value` to release
+their own references and free them. Each thread has its own queue */
+static __thread Value **doomed = NULL;
+static __thread size_t doomed_count = 0;
+static __thread size_t doomed_capacity = 0;
+
+// ==========
+// Allocation
+// ==========
+
+/*
+ * src/value.c:new_value
+ * buildyourownlisp.com correspondence: none
+ *
+ * Allocate a Value of the given type from the Value slab, with a single
+ * reference to it. It counts as already marked by any garbage collection in
+ * progress. Its data is left for the constructor to fill in.
+ *
+ */
+static inline Value *new_value(ValueType type) {
+  Value *value = slab_alloc(&current_heap->values);
+  value->type = type;
+  value->mark = gc_epoch;
+  value->references = 1;
+  return value;
+}
+
+// Functions come from their own slab, since they are larger than Values
+static inline Function *new_function(void) {
+  return slab_alloc(&current_heap->functions);
+}
+
+/*
+ * src/value.c:make_heap
+ * buildyourownlisp.com correspondence: none
+ *
+ * Create an empty Heap, for a thread other than the main one to allocate
+ * Values from.
+ *
+ */
+Heap *make_heap(void) {
+  Heap *heap = malloc(sizeof(Heap));
+  *heap = (Heap){SLAB_FOR(Value), SLAB_FOR(Function)};
+  return heap;
+}
+
+/*
+ * src/value.c:enter_heap
+ * buildyourownlisp.com correspondence: none
+ *
+ * Have the calling thread allocate its Values from the given Heap, and only
+ * free Values that were allocated from it, until it calls `leave_heap`.
+ *
+ */
+void enter_heap(Heap *heap) { current_heap = heap; }
+
+/*
+ * src/value.c:leave_heap
+ * buildyourownlisp.com correspondence: none
+ *
+ * Stop allocating from the Heap given to `enter_heap`, and free the calling
+ * thread's queue for `delete_value`. Must be called by a thread before it
+ * exits, if it entered a Heap.
+ *
+ */
+void leave_heap(void) {
+  current_heap = &main_heap;
+  free(doomed);
+  doomed = NULL;
+  doomed_capacity = 0;
+}
+
+/*
+ * src/value.c:merge_heap
+ * buildyourownlisp.com correspondence: none
+ *
+ * Move every Value and Function allocated from the given Heap into the main
+ * one, then free the Heap. The thread that used it must be done with it.
+ *
+ */
+void merge_heap(Heap *heap) {
+  slab_merge(&main_heap.values, &heap->values);
+  slab_merge(&main_heap.functions, &heap->functions);
+  free(heap);
+}
+
+/*
+ * src/value.c:release_values
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the memory of the Value and Function slabs, and of the queue used by
+ * `delete_value`, to the system. Must only be called at the end of the
+ * program, once no Value is in use. Values that only the garbage collector
+ * could have freed, such as lists that hold themselves, are freed first.
+ *
+ */
+void release_values(void) {
+  slab_walk_begin(&main_heap.values);
+  for (Value *value; (value = slab_walk_next(&main_heap.values));) {
+    destroy_value(value);
+  }
+  slab_release(&main_heap.values);
+  slab_release(&main_heap.functions);
+  free(doomed);
+  doomed = NULL;
+  doomed_capacity = 0;
+}
 
 // ============================
 // Constructors and destructors
 // ============================
 
 /*
- * src/value.c:make_number
- * buildyourownlisp.com correspondence: lval_num
+ * src/value.c:make_symbol
+ * buildyourownlisp.com correspondence: lval_sym
  *
- * Create a new number Value from the provided double.
+ * Create a new symbol Value from the provided string, which gets interned.
  *
  */
-Value *make_number(double number) {
-  Value *value = malloc(sizeof(Value));
-  value->type = NUMBER;
-  value->data.number = number;
-  return value;
+Value *make_symbol(char const *name) {
+  return make_interned_symbol(intern(name));
 }
 
 /*
- * src/value.c:make_symbol
+ * src/value.c:make_interned_symbol
  * buildyourownlisp.com correspondence: lval_sym
  *
- * Create a new symbol Value from the provided string.
+ * Create a new symbol Value from a name that is already interned.
  *
  */
-Value *make_symbol(Symbol symbol) {
-  Value *value = malloc(sizeof(Value));
-  value->type = SYMBOL;
-  value->data.symbol = malloc(strlen(symbol) + 1);
-  strcpy(value->data.symbol, symbol);
+Value *make_interned_symbol(Symbol name) {
+  Value *value = new_value(SYMBOL);
+  value->data.symbol.name = name;
+  value->data.symbol.slot = 0;
   return value;
 }
 
@@ -43,13 +166,11 @@ Value *make_symbol(Symbol symbol) {
  * Create a new function Value from the provided name and builtin.
  *
  */
-Value *make_builtin(Symbol name, Builtin builtin) {
-  Value *value = malloc(sizeof(Value));
-  value->type = FUNCTION;
+Value *make_builtin(char const *name, Builtin builtin) {
+  Value *value = new_value(FUNCTION);
 
-  Function *function = malloc(sizeof(Function));
-  function->name = malloc(strlen(name) + 1);
-  strcpy(function->name, name);
+  Function *function = new_function();
+  function->name = intern(name);
   function->builtin = builtin;
 
   value->data.function = function;
@@ -65,15 +186,15 @@ Value *make_builtin(Symbol name, Builtin builtin) {
  *
  */
 Value *make_lambda(Value *params, Value *body) {
-  Value *value = malloc(sizeof(Value));
-  value->type = FUNCTION;
+  Value *value = new_value(FUNCTION);
 
-  Function *function = malloc(sizeof(Function));
+  Function *function = new_function();
   function->name = NULL;
   function->builtin = NULL;
   function->env = make_env();
   function->params = params;
   function->body = body;
+  function->code = compile_body(body);
 
   value->data.function = function;
   return value;
@@ -87,10 +208,12 @@ Value *make_lambda(Value *params, Value *body) {
  *
  */
 Value *make_sexpr() {
-  Value *value = malloc(sizeof(Value));
-  value->type = SEXPR;
+  Value *value = new_value(SEXPR);
   value->data.sexpr.count = 0;
+  value->data.sexpr.start = 0;
+  value->data.sexpr.capacity = 0;
   value->data.sexpr.cell = NULL;
+  value->data.sexpr.backing = NULL;
   return value;
 }
 
@@ -102,10 +225,37 @@ Value *make_sexpr() {
  *
  */
 Value *make_qexpr() {
-  Value *value = malloc(sizeof(Value));
-  value->type = QEXPR;
+  Value *value = new_value(QEXPR);
   value->data.sexpr.count = 0;
+  value->data.sexpr.start = 0;
+  value->data.sexpr.capacity = 0;
   value->data.sexpr.cell = NULL;
+  value->data.sexpr.backing = NULL;
+  return value;
+}
+
+// Allocate an aligned array for the numbers of a vector
+static double *allocate_numbers(size_t count) {
+  void *memory = NULL;
+  if (count > 0 && posix_memalign(&memory, VECTOR_ALIGNMENT,
+                                  sizeof(double) * count) != 0) {
+    abort();
+  }
+  return memory;
+}
+
+/*
+ * src/value.c:make_vector
+ * buildyourownlisp.com correspondence: none
+ *
+ * Create a new vector Value with room for the given count of numbers, which
+ * the caller must fill in.
+ *
+ */
+Value *make_vector(size_t count) {
+  Value *value = new_value(VECTOR);
+  value->data.vector.count = count;
+  value->data.vector.numbers = allocate_numbers(count);
   return value;
 }
 
@@ -118,8 +268,7 @@ Value *make_qexpr() {
  *
  */
 Value *make_error(char *format, ...) {
-  Value *value = malloc(sizeof(Value));
-  value->type = ERROR;
+  Value *value = new_value(ERROR);
 
   /* Create and initialize a list of arguments */
   va_list pieces;
@@ -157,55 +306,208 @@ Value *va_list_make_error(char *format, va_list pieces) {
   return value;
 }
 
+// Find the start of the array that holds the elements of a list
+static inline Value **cells_of(Value *list) {
+  return list->data.sexpr.cell ? list->data.sexpr.cell - list->data.sexpr.start
+                               : NULL;
+}
+
+// Check if a Value may be seen by others than whoever holds this reference
+static inline bool is_shared(Value *value) {
+  return value->references != 1 || IS_VIEW(value);
+}
+
 /*
- * src/value.c:delete_value
+ * src/value.c:find_elements
+ * buildyourownlisp.com correspondence: none
+ *
+ * Find which slots of the array of a list that is not a view hold elements:
+ * its own, from `low` up to (but not including) `high`, widened to take in any
+ * that its views have claimed. Those are always right next to the others, and
+ * every other slot is NULL.
+ *
+ */
+static inline void find_elements(Value *list, size_t *low, size_t *high) {
+  Sexpr *sexpr = &list->data.sexpr;
+  Value **cells = cells_of(list);
+  *low = sexpr->start;
+  *high = sexpr->start + sexpr->count;
+  if (sexpr->count == 0) {
+    return;
+  }
+  while (*low > 0 && cells[*low - 1]) {
+    (*low)--;
+  }
+  while (*high < sexpr->capacity && cells[*high]) {
+    (*high)++;
+  }
+}
+
+/*
+ * src/value.c:release_claims
+ * buildyourownlisp.com correspondence: none
+ *
+ * Drop the elements that views of a list, which are all gone now that nobody
+ * else holds a reference to it, claimed around its own ones, so that the list
+ * can be changed in place.
+ *
+ */
+static void release_claims(Value *list) {
+  size_t low, high;
+  find_elements(list, &low, &high);
+  Sexpr *sexpr = &list->data.sexpr;
+  Value **cells = cells_of(list);
+  for (size_t index = low; index < sexpr->start; index++) {
+    delete_value(cells[index]);
+    cells[index] = NULL;
+  }
+  for (size_t index = sexpr->start + sexpr->count; index < high; index++) {
+    delete_value(cells[index]);
+    cells[index] = NULL;
+  }
+}
+
+/*
+ * src/value.c:destroy_value
  * buildyourownlisp.com correspondence: lval_del
  *
- * Release the memory taken up by a Value, including its nested Values.
+ * Release the memory taken up by a Value itself, without touching the Values
+ * nested within it. Only `delete_value` and the garbage collector, which deal
+ * with nested Values on their own, should call this.
  *
  */
-void delete_value(Value *value) {
+void destroy_value(Value *value) {
   switch (value->type) {
-  /* Do nothing special for numbers */
   case NUMBER:
     break;
   /* What to free is different for builtins and user-defined functions */
   case FUNCTION:
-    if (value->data.function->builtin) {
-      free(value->data.function->name);
-    } else {
-      free(value->data.function->env);
-      free(value->data.function->params);
-      free(value->data.function->body);
+    if (!value->data.function->builtin) {
+      destroy_env(value->data.function->env);
+      delete_code(value->data.function->code);
     }
-    free(value->data.function);
+    slab_free(&current_heap->functions, value->data.function);
     break;
-  /* For Symbol (and ErrorMsg, below), free the string data */
+  /* Symbols are interned, and never freed */
   case SYMBOL:
-    free(value->data.symbol);
     break;
-  /* For Sexpr delete all the elements inside */
+  /* For Sexpr free the memory allocated to contain the pointers, unless it
+  belongs to another list */
   case SEXPR:
   case QEXPR:
-    for (size_t index = 0; index < count(value); index++) {
-      delete_value(element_at(value, index));
+    if (!value->data.sexpr.backing) {
+      free(cells_of(value));
     }
-    /* Also free the memory allocated to contain the pointers */
-    free(value->data.sexpr.cell);
     break;
+  /* For ErrorMsg, free the string data */
   case ERROR:
     free(value->data.error);
     break;
+  case VECTOR:
+    free(value->data.vector.numbers);
+    break;
   }
 
-  /* Free the memory allocated for the Value itself */
-  free(value);
+  /* Give the memory used by the Value itself back to the slab */
+  slab_free(&current_heap->values, value);
+}
+
+// Drop a reference, queueing the Value to be freed if it was the last one
+static void release_reference(Value *value) {
+  /* Numbers are immediate, so there is nothing to free */
+  if (IS_IMMEDIATE(value) || --value->references > 0) {
+    return;
+  }
+  if (doomed_count == doomed_capacity) {
+    doomed_capacity = doomed_capacity ? doomed_capacity * 2 : 64;
+    doomed = realloc(doomed, sizeof(Value *) * doomed_capacity);
+  }
+  doomed[doomed_count++] = value;
+}
+
+/*
+ * src/value.c:delete_value
+ * buildyourownlisp.com correspondence: lval_del
+ *
+ * Drop a reference to a Value. When it was the last one, release the memory
+ * taken up by the Value, and drop its references to nested Values. Nested
+ * Values are dealt with through a queue rather than by recursion, so there is
+ * no limit to how deeply they may be nested.
+ *
+ */
+void delete_value(Value *value) {
+  size_t base = doomed_count;
+  release_reference(value);
+  while (doomed_count > base) {
+    Value *next = doomed[--doomed_count];
+    visit_children(next, release_reference);
+    destroy_value(next);
+  }
 }
 
 // ========================
 // Information about Values
 // ========================
 
+/*
+ * src/value.c:visit_children
+ * buildyourownlisp.com correspondence: none
+ *
+ * Call `visit` on every Value that the given Value holds a reference to: the
+ * elements of a list, including those claimed by its views (or, for a view,
+ * the list it belongs to), or the params, body and Env contents of a lambda.
+ *
+ */
+void visit_children(Value *value, void (*visit)(Value *)) {
+  switch (TYPE_OF(value)) {
+  case FUNCTION:
+    if (!value->data.function->builtin) {
+      Env *env = value->data.function->env;
+      for (size_t index = 0; index < env->count; index++) {
+        visit(env->entries[index].value);
+      }
+      visit(value->data.function->params);
+      visit(value->data.function->body);
+    }
+    break;
+  case SEXPR:
+  case QEXPR:
+    if (value->data.sexpr.backing) {
+      visit(value->data.sexpr.backing);
+      break;
+    }
+    size_t low, high;
+    find_elements(value, &low, &high);
+    for (size_t index = low; index < high; index++) {
+      visit(cells_of(value)[index]);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/*
+ * src/value.c:live_values
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the number of heap Values currently allocated.
+ *
+ */
+size_t live_values(void) { return main_heap.values.live; }
+
+/*
+ * src/value.c:walk_values_begin
+ * buildyourownlisp.com correspondence: none
+ *
+ * Start walking over every heap Value currently allocated; `walk_values_next`
+ * returns them one at a time, then NULL. Used by the garbage collector.
+ *
+ */
+void walk_values_begin(void) { slab_walk_begin(&main_heap.values); }
+
+Value *walk_values_next(void) { return slab_walk_next(&main_heap.values); }
+
 /*
  * src/value.c:count
  * buildyourownlisp.com correspondence: none
@@ -216,7 +518,7 @@ void delete_value(Value *value) {
  *
  */
 inline size_t count(Value *sexpr_value) {
-  switch (sexpr_value->type) {
+  switch (TYPE_OF(sexpr_value)) {
   case QEXPR:
   case SEXPR:
     return sexpr_value->data.sexpr.count;
@@ -235,7 +537,7 @@ inline size_t count(Value *sexpr_value) {
  *
  */
 char *get_type(Value *value) {
-  switch (value->type) {
+  switch (TYPE_OF(value)) {
   case NUMBER:
     return "Number";
   case SYMBOL:
@@ -248,123 +550,172 @@ char *get_type(Value *value) {
     return "Q-Expression (List)";
   case ERROR:
     return "Error";
+  case VECTOR:
+    return "Vector";
   }
   return "Unreachable value placed here to please the deities of compilation.";
 }
 
 /*
- * src/value.c:stringify_number
+ * src/value.c:write_number
  * buildyourownlisp.com correspondence: none
  *
- * Return the string equivalent of a number Value. Used in error reporting in
- * arithmetic operations.
+ * Write the string equivalent of a number Value into a StringBuilder: the
+ * shortest one that reads back as the same number (see number.h).
  *
  */
-static char *stringify_number(Value *value, char *result) {
+static void write_number(StringBuilder *builder, Value *value) {
   // Must be called with a Number value, or everything crashes
   if (!IS_NUMBER(value)) {
     exit(EX_SOFTWARE);
   }
 
-  double rounded = round(value->data.number);
-  if (rounded == value->data.number) {
-    REALLOC_STRING("%li", (long)rounded, result);
-  } else {
-    REALLOC_STRING("%g", value->data.number, result);
+  char *text = reserve_chars(builder, NUMBER_LENGTH);
+  commit_chars(builder, format_number(number_of(value), text));
+}
+
+/* A list or lambda being written, and how far into it we are */
+typedef struct Pending {
+  Value *value;
+  size_t index;
+} Pending;
+
+/*
+ * src/value.c:write_start
+ * buildyourownlisp.com correspondence: lval_print
+ *
+ * Start writing a Value into a StringBuilder. Values without nested Values are
+ * written whole; lists and lambdas only get their opening written, and are
+ * pushed onto the stack of pending Values so the rest is written later.
+ *
+ */
+static void write_start(StringBuilder *builder, Value *value,
+                        Pending **pending, size_t *depth, size_t *capacity) {
+  switch (TYPE_OF(value)) {
+  case NUMBER:
+    write_number(builder, value);
+    return;
+  case SYMBOL:
+    append_string(builder, value->data.symbol.name);
+    return;
+  case FUNCTION:
+    if (value->data.function->builtin) {
+      append_string(builder, value->data.function->name);
+      return;
+    }
+    append_string(builder, "(\\ ");
+    break;
+  case SEXPR:
+    append_char(builder, '(');
+    break;
+  case QEXPR:
+    append_char(builder, '{');
+    break;
+  case ERROR:
+    append_string(builder, "Error: ");
+    append_string(builder, value->data.error);
+    return;
+  /* A vector has no nested Values, only numbers */
+  case VECTOR:
+    append_char(builder, '[');
+    for (size_t index = 0; index < value->data.vector.count; index++) {
+      if (index > 0) {
+        append_char(builder, ' ');
+      }
+      write_number(builder, make_number(value->data.vector.numbers[index]));
+    }
+    append_char(builder, ']');
+    return;
   }
 
-  return result;
+  if (*depth == *capacity) {
+    *capacity = *capacity ? *capacity * 2 : 16;
+    *pending = realloc(*pending, sizeof(Pending) * *capacity);
+  }
+  (*pending)[(*depth)++] = (Pending){value, 0};
 }
 
 /*
- * src/value.c:stringify_list
- * buildyourownlisp.com correspondence: lval_print_expr
+ * src/value.c:write_value
+ * buildyourownlisp.com correspondence: lval_print
  *
- * Return the string representation of a list, including its elements.
+ * Write the string representation of a Value into a StringBuilder. Nested
+ * Values are written using an explicit stack rather than by recursion, so
+ * there is no limit to how deeply they may be nested.
  *
  */
-static char *stringify_list(Value *value, char *open, char *close) {
-  char *result = malloc(strlen(open) + 1);
-  strcpy(result, open);
+static void write_value(StringBuilder *builder, Value *value) {
+  Pending *pending = NULL;
+  size_t depth = 0;
+  size_t capacity = 0;
 
-  size_t length = count(value);
-  for (size_t index = 0; index < length; index++) {
-    char *element_string = stringify(element_at(value, index));
-    result = realloc(result, strlen(result) + strlen(element_string) + 1);
-    strcat(result, element_string);
-    free(element_string);
-    /* Don't print trailing space if last element */
-    if (index != length - 1) {
-      result = realloc(result, strlen(result) + 2);
-      strcat(result, " ");
+  write_start(builder, value, &pending, &depth, &capacity);
+
+  while (depth > 0) {
+    Pending *top = &pending[depth - 1];
+    Value *next = NULL;
+
+    if (IS_FUNCTION(top->value)) {
+      /* A lambda is written as (\ params body) */
+      switch (top->index++) {
+      case 0:
+        next = top->value->data.function->params;
+        break;
+      case 1:
+        append_char(builder, ' ');
+        next = top->value->data.function->body;
+        break;
+      default:
+        append_char(builder, ')');
+        depth--;
+        continue;
+      }
+    } else if (top->index < count(top->value)) {
+      /* Don't print a space before the first element */
+      if (top->index > 0) {
+        append_char(builder, ' ');
+      }
+      next = element_at(top->value, top->index++);
+    } else {
+      append_char(builder, IS_SEXPR(top->value) ? ')' : '}');
+      depth--;
+      continue;
     }
+
+    write_start(builder, next, &pending, &depth, &capacity);
   }
-  result = realloc(result, strlen(result) + 2);
-  strcat(result, close);
 
-  return result;
+  free(pending);
 }
 
 /*
  * src/value.c:stringify
  * buildyourownlisp.com correspondence: none
  *
- * Return a string representation of a Value, for use in print functions.
+ * Return the string representation of a Value, which the caller must free.
  *
  */
 char *stringify(Value *value) {
-  char *result = NULL;
-  switch (value->type) {
-  case NUMBER:
-    result = stringify_number(value, result);
-    break;
-  case SYMBOL:
-    result = realloc(result, strlen(value->data.symbol) + 1);
-    strcpy(result, value->data.symbol);
-    break;
-  case FUNCTION:
-    if (value->data.function->builtin) {
-      result = realloc(result, strlen(value->data.function->name) + 1);
-      strcpy(result, value->data.function->name);
-    } else {
-      char *params_string = stringify(value->data.function->params);
-      char *body_string = stringify(value->data.function->body);
-      result = realloc(result, strlen("(\\ )") + strlen(params_string) + 1 +
-                                   strlen(body_string) + 1);
-      sprintf(result, "(\\ %s %s)", params_string, body_string);
-      free(params_string);
-      free(body_string);
-    }
-    break;
-  case SEXPR:
-    result = stringify_list(value, "(", ")");
-    break;
-  case QEXPR:
-    result = stringify_list(value, "{", "}");
-    break;
-  case ERROR:
-    result = realloc(result, strlen(value->data.error) + 8);
-    result[0] = '\0';
-    strcpy(result, "Error: ");
-    strcat(result, value->data.error);
-    break;
-  }
-
-  return result;
+  StringBuilder builder;
+  start_builder(&builder, NULL);
+  write_value(&builder, value);
+  return finish_builder(&builder);
 }
 
 /*
- * src/value.c:print_value_no_newline
+ * src/value.c:print_value
  * buildyourownlisp.com correspondence: lval_print
  *
- * Print a Value. Since this can be nested within a list, no newline is
- * printed at the end.
+ * Print a Value to a file. It is written out as it goes, never as a whole
+ * string, so printing even a huge list takes little memory. Since this can be
+ * nested within a list, no newline is printed at the end.
  *
  */
-static void print_value_no_newline(Value *value) {
-  char *result = stringify(value);
-  printf("%s", result);
-  free(result);
+void print_value(FILE *file, Value *value) {
+  StringBuilder builder;
+  start_builder(&builder, file);
+  write_value(&builder, value);
+  finish_builder(&builder);
 }
 
 /*
@@ -375,7 +726,7 @@ static void print_value_no_newline(Value *value) {
  *
  */
 void println_value(Value *value) {
-  print_value_no_newline(value);
+  print_value(stdout, value);
   putchar('\n');
 }
 
@@ -395,7 +746,7 @@ void println_value(Value *value) {
  *
  */
 Value *element_at(Value *sexpr_value, size_t index) {
-  switch (sexpr_value->type) {
+  switch (TYPE_OF(sexpr_value)) {
   case QEXPR:
   case SEXPR:
     return sexpr_value->data.sexpr.cell[index];
@@ -412,22 +763,32 @@ Value *element_at(Value *sexpr_value, size_t index) {
  * Remove and return the Value from the given list at the given index.
  * Compare with the more destructive `take_value`, which deletes the list, and
  * the more conservative `element_at`, which maintains the element in place.
+ * Popping the first element takes constant time. Since the list is changed, it
+ * must not be shared (see `unshare_value`).
  *
  */
 Value *pop_value(Value *value, size_t index) {
-  /* Find the value to pop */
+  Sexpr *list = &value->data.sexpr;
   Value *popped = element_at(value, index);
 
-  /* Shift memory after the popped item */
-  memmove(&value->data.sexpr.cell[index], &value->data.sexpr.cell[index + 1],
-          sizeof(Value *) * (count(value) - index - 1));
-
-  /* Decrement the size of the list */
-  value->data.sexpr.count--;
+  /* Popping the first element just moves the start of the list; otherwise,
+  shift memory after the popped item */
+  if (index == 0) {
+    list->cell[0] = NULL;
+    list->cell++;
+    list->start++;
+  } else {
+    memmove(&list->cell[index], &list->cell[index + 1],
+            sizeof(Value *) * (list->count - index - 1));
+    list->cell[list->count - 1] = NULL;
+  }
+  list->count--;
 
-  /* Reallocate the memory used */
-  value->data.sexpr.cell =
-      realloc(value->data.sexpr.cell, sizeof(Value *) * count(value));
+  /* An empty list may as well start over at the front of its array */
+  if (list->count == 0 && list->cell) {
+    list->cell -= list->start;
+    list->start = 0;
+  }
   return popped;
 }
 
@@ -439,13 +800,128 @@ inline Value *pop(Value *value) { return pop_value(value, 0); }
  * buildyourownlisp.com correspondence: lval_take
  *
  * Replace an entire list by its element at the given index, destroying the
- * list. Compare with the less destructive `pop_value` and `element_at`.
+ * list. Compare with the less destructive `pop_value` and `element_at`. If
+ * nobody else holds the list, the element is moved out of it rather than
+ * copied, so that it is not shared either if the list was its only holder.
  *
  */
 Value *take_value(Value *value, size_t index) {
-  Value *popped = pop_value(value, index);
+  if (is_shared(value)) {
+    Value *taken = copy_value(element_at(value, index));
+    delete_value(value);
+    return taken;
+  }
+
+  release_claims(value);
+  Value *taken = pop_value(value, index);
   delete_value(value);
-  return popped;
+  return taken;
+}
+
+/*
+ * src/value.c:slice_value
+ * buildyourownlisp.com correspondence: none
+ *
+ * Replace a list by the `length` of its elements starting at `offset`, which
+ * must be within it. The result is a view of the list, sharing its elements
+ * rather than copying them (or the list itself, if that is all of it), so this
+ * takes constant time. A view of a view is a view of the same backing list.
+ *
+ */
+Value *slice_value(Value *list, size_t offset, size_t length) {
+  if (offset == 0 && length == count(list)) {
+    return list;
+  }
+  if (length == 0) {
+    Value *empty = IS_SEXPR(list) ? make_sexpr() : make_qexpr();
+    delete_value(list);
+    return empty;
+  }
+
+  Value *backing = list->data.sexpr.backing ? list->data.sexpr.backing : list;
+  Value *view = new_value(list->type);
+  view->data.sexpr.count = length;
+  view->data.sexpr.start = 0;
+  view->data.sexpr.capacity = 0;
+  view->data.sexpr.cell = list->data.sexpr.cell + offset;
+  view->data.sexpr.backing = copy_value(backing);
+  delete_value(list);
+  return view;
+}
+
+/*
+ * src/value.c:claim_slots
+ * buildyourownlisp.com correspondence: none
+ *
+ * Replace a shared list by a longer view of the same array, that also takes
+ * up the `before` slots in front of the list's elements and the `after` slots
+ * behind them, for the caller to fill in. This takes constant time, and the
+ * original list is left as it was: other views of the array never look at
+ * those slots, and no other list may claim them any more. Return NULL, and
+ * leave the list alone, if the slots are not free, or if the list is not
+ * shared and may just as well be changed in place.
+ *
+ */
+static Value *claim_slots(Value *list, size_t before, size_t after) {
+  Sexpr *sexpr = &list->data.sexpr;
+  if (sexpr->count == 0 || !is_shared(list)) {
+    return NULL;
+  }
+
+  Value *backing = sexpr->backing ? sexpr->backing : list;
+  Value **cells = cells_of(backing);
+  size_t first = (size_t)(sexpr->cell - cells);
+  size_t last = first + sexpr->count;
+  if (first < before || last + after > backing->data.sexpr.capacity ||
+      (before > 0 && cells[first - 1]) || (after > 0 && cells[last])) {
+    return NULL;
+  }
+
+  Value *view = new_value(list->type);
+  view->data.sexpr.count = before + sexpr->count + after;
+  view->data.sexpr.start = 0;
+  view->data.sexpr.capacity = 0;
+  view->data.sexpr.cell = sexpr->cell - before;
+  view->data.sexpr.backing = copy_value(backing);
+  delete_value(list);
+  return view;
+}
+
+/*
+ * src/value.c:reserve_elements
+ * buildyourownlisp.com correspondence: none
+ *
+ * Make room at the end of a list for `extra` more elements. If there is as
+ * much room in front of the elements as they take up, they are moved there;
+ * otherwise the array grows geometrically, so appending to a list one element
+ * at a time takes amortized constant time. The list must not be shared.
+ *
+ */
+void reserve_elements(Value *list, size_t extra) {
+  Sexpr *sexpr = &list->data.sexpr;
+  if (sexpr->start + sexpr->count + extra <= sexpr->capacity) {
+    return;
+  }
+
+  Value **cells = cells_of(list);
+  if (sexpr->start >= sexpr->count &&
+      sexpr->count + extra <= sexpr->capacity) {
+    memcpy(cells, sexpr->cell, sizeof(Value *) * sexpr->count);
+    memset(sexpr->cell, 0, sizeof(Value *) * sexpr->count);
+    sexpr->cell = cells;
+    sexpr->start = 0;
+    return;
+  }
+
+  size_t capacity = sexpr->capacity ? sexpr->capacity : 4;
+  while (capacity < sexpr->start + sexpr->count + extra) {
+    capacity *= 2;
+  }
+  cells = realloc(cells, sizeof(Value *) * capacity);
+  memset(cells + sexpr->capacity, 0,
+         sizeof(Value *) * (capacity - sexpr->capacity));
+  sexpr->cell = cells + sexpr->start;
+  sexpr->capacity = capacity;
 }
 
 /*
@@ -454,15 +930,53 @@ Value *take_value(Value *value, size_t index) {
  *
  * Append the given Value at the end of the given (S-/Q-Expr) list. This is
  * used internally by the interpreter, e.g. while parsing lists, as opposed to
- * `builtin_cons`, which is exposed to the user.
+ * `builtin_cons`, which is exposed to the user. The list must not be shared
+ * (see `unshare_value`).
  *
  */
 Value *append_value(Value *list, Value *new_value) {
-  list->data.sexpr.count++;
-  list->data.sexpr.cell =
-      realloc(list->data.sexpr.cell, sizeof(Value *) * count(list));
+  reserve_elements(list, 1);
+  list->data.sexpr.cell[list->data.sexpr.count++] = new_value;
+  return list;
+}
 
-  list->data.sexpr.cell[count(list) - 1] = new_value;
+/*
+ * src/value.c:prepend_value
+ * buildyourownlisp.com correspondence: none
+ *
+ * Put the given Value in front of the given (S-/Q-Expr) list. When there is
+ * no room left there, the elements are moved to a new array with as much room
+ * in front of them as they take up, so this also takes amortized constant
+ * time. A shared list is left as it was, and the result is a view that claims
+ * the free slot in front of it if it can (see `claim_slots`), or a copy.
+ *
+ */
+Value *prepend_value(Value *list, Value *new_value) {
+  Value *claimed = claim_slots(list, 1, 0);
+  if (claimed) {
+    claimed->data.sexpr.cell[0] = new_value;
+    return claimed;
+  }
+
+  list = unshare_value(list);
+  Sexpr *sexpr = &list->data.sexpr;
+  if (sexpr->start == 0) {
+    size_t front = sexpr->count > 4 ? sexpr->count : 4;
+    size_t capacity = front + sexpr->capacity;
+    Value **cells = calloc(capacity, sizeof(Value *));
+    if (sexpr->count > 0) {
+      memcpy(cells + front, sexpr->cell, sizeof(Value *) * sexpr->count);
+    }
+    free(cells_of(list));
+    sexpr->cell = cells + front;
+    sexpr->start = front;
+    sexpr->capacity = capacity;
+  }
+
+  sexpr->cell--;
+  sexpr->start--;
+  sexpr->count++;
+  sexpr->cell[0] = new_value;
   return list;
 }
 
@@ -470,74 +984,104 @@ Value *append_value(Value *list, Value *new_value) {
  * src/value.c:join_values
  * buildyourownlisp.com correspondence: lval_join
  *
- * Concatenate two lists. Used internally by the interpreter.
+ * Concatenate two lists. Used internally by the interpreter. When `left` is
+ * shared, it is left as it was, and the result is a view that claims the free
+ * slots behind it if there are enough of them (see `claim_slots`), or a copy.
+ * The elements of `right` are moved over if nobody else holds it.
  *
  */
 Value *join_values(Value *left, Value *right) {
-  /* For each cell in `right` add it to `left` */
-  while (count(right)) {
-    left = append_value(left, pop(right));
+  size_t length = count(right);
+
+  /* A shared `left` may have room behind it for the elements of `right`;
+  otherwise make room at the end of its own (or a copy's) array */
+  Value *joined = length > 0 ? claim_slots(left, 0, length) : NULL;
+  if (!joined) {
+    joined = unshare_value(left);
+    reserve_elements(joined, length);
+    joined->data.sexpr.count += length;
+  }
+  Value **slots = joined->data.sexpr.cell + count(joined) - length;
+
+  /* The elements of a `right` that nobody else holds are moved, not copied */
+  if (is_shared(right)) {
+    for (size_t index = 0; index < length; index++) {
+      slots[index] = copy_value(element_at(right, index));
+    }
+  } else {
+    release_claims(right);
+    if (length > 0) {
+      memcpy(slots, right->data.sexpr.cell, sizeof(Value *) * length);
+    }
+    right->data.sexpr.count = 0;
   }
 
-  /* Delete the empty `right` and return `left` */
   delete_value(right);
-  return left;
+  return joined;
 }
 
 /*
- * src/value.c:copy_value
+ * src/value.c:clone_value
  * buildyourownlisp.com correspondence: lval_copy
  *
- * Return a copy of the Value. This is useful in situations where we transform
- * an input Value and must delete it before returning; if the transformed
- * version were not a copy, important information from it would be lost due to
- * it sharing data with the original.
+ * Return a new heap Value with the same contents as the given one. Nested
+ * Values are not cloned: the new Value takes a reference to each of them.
  *
  */
-Value *copy_value(Value *value) {
-  Value *copy = malloc(sizeof(Value));
-  copy->type = value->type;
+static Value *clone_value(Value *value) {
+  Value *copy = new_value(value->type);
 
   switch (value->type) {
-  /* Copy Functions and Numbers directly */
   case NUMBER:
-    copy->data.number = value->data.number;
     break;
-  /* We copy the name and the pointer of the function */
+  /* We copy the (interned) name and the pointer of the function */
   case FUNCTION: {
-    Function *fun_copy = malloc(sizeof(Function));
+    Function *fun_copy = new_function();
 
     if (value->data.function->builtin) {
-      fun_copy->name = malloc(strlen(value->data.function->name) + 1);
-      strcpy(fun_copy->name, value->data.function->name);
+      fun_copy->name = value->data.function->name;
       fun_copy->builtin = value->data.function->builtin;
       fun_copy->env = NULL;
       fun_copy->params = NULL;
       fun_copy->body = NULL;
+      fun_copy->code = NULL;
     } else {
       fun_copy->name = NULL;
       fun_copy->builtin = NULL;
       fun_copy->env = copy_env(value->data.function->env);
       fun_copy->params = copy_value(value->data.function->params);
       fun_copy->body = copy_value(value->data.function->body);
+      fun_copy->code = copy_code(value->data.function->code);
     }
 
     copy->data.function = fun_copy;
     break;
   }
-  /* Copy strings using malloc and strcpy */
+  /* Symbols are interned, so there is no string to copy */
   case SYMBOL:
-    copy->data.symbol = malloc(strlen(value->data.symbol) + 1);
-    strcpy(copy->data.symbol, value->data.symbol);
+    copy->data.symbol = value->data.symbol;
     break;
+  /* Copy error messages using malloc and strcpy */
   case ERROR:
     copy->data.error = malloc(strlen(value->data.error) + 1);
     strcpy(copy->data.error, value->data.error);
     break;
-  /* Copy lists by copying each sub-expression */
+  /* Copy the numbers of a vector */
+  case VECTOR:
+    copy->data.vector.count = value->data.vector.count;
+    copy->data.vector.numbers = allocate_numbers(value->data.vector.count);
+    if (value->data.vector.count > 0) {
+      memcpy(copy->data.vector.numbers, value->data.vector.numbers,
+             sizeof(double) * value->data.vector.count);
+    }
+    break;
+  /* Copy lists by taking a reference to each sub-expression */
   case SEXPR:
   case QEXPR:
     copy->data.sexpr.count = value->data.sexpr.count;
+    copy->data.sexpr.start = 0;
+    copy->data.sexpr.capacity = value->data.sexpr.count;
+    copy->data.sexpr.backing = NULL;
     copy->data.sexpr.cell = malloc(sizeof(Value *) * value->data.sexpr.count);
     for (size_t index = 0; index < copy->data.sexpr.count; index++) {
       copy->data.sexpr.cell[index] = copy_value(value->data.sexpr.cell[index]);
@@ -547,3 +1091,51 @@ Value *copy_value(Value *value) {
 
   return copy;
 }
+
+/*
+ * src/value.c:copy_value
+ * buildyourownlisp.com correspondence: lval_copy
+ *
+ * Return a copy of the Value. This is useful in situations where we transform
+ * an input Value and must delete it before returning. Values are reference
+ * counted, so the copy is just another reference to the same Value; it costs
+ * the same no matter how big the Value is. Code that wants to change a Value
+ * must first call `unshare_value` on it.
+ *
+ */
+Value *copy_value(Value *value) {
+  /* Numbers are immediate, so they are their own copy */
+  if (!IS_IMMEDIATE(value)) {
+    value->references++;
+  }
+  return value;
+}
+
+/*
+ * src/value.c:unshare_value
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return a Value that can safely be changed in place, with the same contents
+ * as the given one (copy-on-write). If nobody else holds a reference to the
+ * Value, and it is not a view of another list (see `slice_value`), that is the
+ * Value itself; otherwise, the caller's reference is traded for a reference to
+ * a fresh clone.
+ *
+ */
+Value *unshare_value(Value *value) {
+  if (IS_IMMEDIATE(value)) {
+    return value;
+  }
+
+  /* A view's elements belong to its backing list, so it is always shared */
+  if (!is_shared(value)) {
+    if (IS_SEXPR(value) || IS_QEXPR(value)) {
+      release_claims(value);
+    }
+    return value;
+  }
+
+  Value *clone = clone_value(value);
+  delete_value(value);
+  return clone;
+}
@@ -12,74 +12,180 @@
 #include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sysexits.h>
 
-#include "../utils/realloc_string.h"
+#include "../utils/string_builder.h"
 
-/* Forward declarations */
+/* Forward declarations. Symbols are interned (see symbol.h) */
 typedef char *Symbol;
 typedef char *ErrorMsg;
 typedef struct Value Value;
 typedef struct Env Env;
 typedef struct Function Function;
+typedef struct Heap Heap;
 
 /* Enumerate possible Value types */
-typedef enum { NUMBER, SYMBOL, FUNCTION, SEXPR, QEXPR, ERROR } ValueType;
+typedef enum {
+  NUMBER,
+  SYMBOL,
+  FUNCTION,
+  SEXPR,
+  QEXPR,
+  ERROR,
+  VECTOR
+} ValueType;
 
-/* Declare the S-expression struct */
+/* Declare the S-expression struct. The elements are `cell[0]` to
+`cell[count - 1]`, in an array with room for `capacity` of them, which starts
+`start` places before `cell`: taking the first element off only moves `cell`
+forward, and there is room to put elements back in front.
+
+A list may also be a view of part of another list, its `backing`: then `cell`
+points into the backing list's array, which the view holds a reference to
+instead of to the elements themselves (see `slice_value`).
+
+Slots of an array that hold no element are NULL. A shared list can still grow
+into the free slots right next to its elements, without copying them: the
+longer list is a view that claims those slots, whose elements then belong to
+the array (see `claim_slots`) */
 typedef struct Sexpr {
   size_t count;
+  size_t start;
+  size_t capacity;
   struct Value **cell;
+  struct Value *backing;
 } Sexpr;
 
-/* Define the Builtin function pointer type */
+/* Declare the vector struct: `count` numbers side by side, in an array aligned
+to VECTOR_ALIGNMENT bytes so that they can be loaded many at a time (see
+vector.h) */
+#define VECTOR_ALIGNMENT 32
+
+typedef struct Vector {
+  size_t count;
+  double *numbers;
+} Vector;
+
+/* Declare the symbol struct. `slot` is a hint set when a lambda is defined:
+if not zero, the symbol is probably the parameter stored at position
+`slot - 1` of the Env it is evaluated in (see `resolve_params`) */
+typedef struct SymbolRef {
+  Symbol name;
+  size_t slot;
+} SymbolRef;
+
+/* Define the Builtin function pointer type. A builtin owns the S-expression of
+arguments it is passed, which nobody else holds, so it may move them out of it
+(see `take_value`) rather than copy them */
 typedef Value *(*Builtin)(Env *, Value *);
 
-/* Define the Value struct */
+/* Define the Value struct. Numbers never use it: see below */
 struct Value {
   ValueType type;
+  unsigned mark;
+  size_t references;
   union {
-    double number;
-    Symbol symbol;
+    struct SymbolRef symbol;
     ErrorMsg error;
     struct Sexpr sexpr;
+    struct Vector vector;
     struct Function *function;
   } data;
 };
 
+/*
+ * Numbers are immediate: instead of pointing to a Value struct, a number's
+ * `Value *` holds the bits of the double itself, shifted up by NUMBER_OFFSET.
+ * Heap pointers never use the top 16 bits of a word, while every shifted
+ * double does, so that tells the two apart. NaNs are first made canonical, so
+ * that the shift cannot overflow. Numbers are therefore never allocated,
+ * copied or freed.
+ *
+ */
+#if UINTPTR_MAX < UINT64_MAX
+#error "Lye's immediate numbers require 64-bit pointers"
+#endif
+
+#define NUMBER_OFFSET ((uint64_t)1 << 49)
+#define IS_IMMEDIATE(value) (((uintptr_t)(value) >> 48) != 0)
+
+static inline Value *make_number(double number) {
+  uint64_t bits;
+  if (isnan(number)) {
+    number = NAN;
+  }
+  memcpy(&bits, &number, sizeof(bits));
+  return (Value *)(uintptr_t)(bits + NUMBER_OFFSET);
+}
+
+static inline double number_of(Value *value) {
+  uint64_t bits = (uint64_t)(uintptr_t)value - NUMBER_OFFSET;
+  double number;
+  memcpy(&number, &bits, sizeof(number));
+  return number;
+}
+
+/* The type of any Value, immediate or not */
+#define TYPE_OF(value) (IS_IMMEDIATE(value) ? NUMBER : (value)->type)
+
 /* Macros that assert the type of a Value */
-#define IS_NUMBER(value) (value->type == NUMBER)
-#define IS_SYMBOL(value) (value->type == SYMBOL)
-#define IS_FUNCTION(value) (value->type == FUNCTION)
-#define IS_SEXPR(value) (value->type == SEXPR)
-#define IS_QEXPR(value) (value->type == QEXPR)
-#define IS_ERROR(value) (value->type == ERROR)
+#define IS_NUMBER(value) IS_IMMEDIATE(value)
+#define IS_SYMBOL(value) (TYPE_OF(value) == SYMBOL)
+#define IS_FUNCTION(value) (TYPE_OF(value) == FUNCTION)
+#define IS_SEXPR(value) (TYPE_OF(value) == SEXPR)
+#define IS_QEXPR(value) (TYPE_OF(value) == QEXPR)
+#define IS_ERROR(value) (TYPE_OF(value) == ERROR)
+#define IS_VECTOR(value) (TYPE_OF(value) == VECTOR)
+#define IS_VIEW(value)                                                         \
+  ((IS_SEXPR(value) || IS_QEXPR(value)) && (value)->data.sexpr.backing)
 
 /* Value constructors and destructor */
-Value *make_number(double number);
-Value *make_symbol(Symbol symbol);
-Value *make_builtin(Symbol name, Builtin function);
+Value *make_symbol(char const *name);
+Value *make_interned_symbol(Symbol name);
+Value *make_builtin(char const *name, Builtin function);
 Value *make_lambda(Value *params, Value *body);
 Value *make_sexpr(void);
 Value *make_qexpr(void);
+Value *make_vector(size_t count);
 Value *make_error(char *format, ...);
 Value *va_list_make_error(char *format, va_list pieces);
 void delete_value(Value *value);
+void destroy_value(Value *value);
+void release_values(void);
+
+/* Walking the heap, for the garbage collector */
+void visit_children(Value *value, void (*visit)(Value *));
+size_t live_values(void);
+void walk_values_begin(void);
+Value *walk_values_next(void);
+
+/* Heaps for threads other than the main one, which may make Values but must not
+touch the main thread's ones */
+Heap *make_heap(void);
+void enter_heap(Heap *heap);
+void leave_heap(void);
+void merge_heap(Heap *heap);
 
 /* Utility functions for working with Values */
 size_t count(Value *sexpr_value);
 Value *element_at(Value *sexpr_value, size_t index);
 char *get_type(Value *value);
 char *stringify(Value *value);
+void print_value(FILE *file, Value *value);
 void println_value(Value *value);
 Value *pop_value(Value *value, size_t index);
 Value *pop(Value *value);
 Value *take_value(Value *value, size_t index);
+Value *slice_value(Value *list, size_t offset, size_t length);
 Value *append_value(Value *list, Value *new_value);
+Value *prepend_value(Value *list, Value *new_value);
+void reserve_elements(Value *list, size_t extra);
 Value *join_values(Value *left, Value *right);
 Value *copy_value(Value *value);
+Value *unshare_value(Value *value);
 
 #endif
@@ -0,0 +1,479 @@
+#include "vector.h"
+
+/* Enumerate the element-wise operations */
+typedef enum { ADD, SUBTRACT, MULTIPLY, DIVIDE, OPERATIONS } Operation;
+
+/* Define the kernels that work on the numbers of vectors with one instruction
+set. `combine` applies an operation to each number of `into` and the matching
+one of `from`, and `combine_by` to each number of `into` and `scalar`, storing
+the results in `into`. `minimum` and `maximum` need at least one number */
+typedef struct Kernels {
+  void (*combine[OPERATIONS])(double *into, double const *from, size_t count);
+  void (*combine_by[OPERATIONS])(double *into, double scalar, size_t count);
+  double (*sum)(double const *numbers, size_t count);
+  double (*minimum)(double const *numbers, size_t count);
+  double (*maximum)(double const *numbers, size_t count);
+  double (*dot)(double const *left, double const *right, size_t count);
+} Kernels;
+
+// ============
+// Without SIMD
+// ============
+
+/*
+ * src/vector.c:PLAIN_COMBINE
+ * buildyourownlisp.com correspondence: none
+ *
+ * Define both kernels for an element-wise operation, one number at a time.
+ *
+ */
+#define PLAIN_COMBINE(name, op)                                                \
+  static void name(double *into, double const *from, size_t count) {          \
+    for (size_t index = 0; index < count; index++) {                           \
+      into[index] = into[index] op from[index];                                \
+    }                                                                          \
+  }                                                                            \
+  static void name##_by(double *into, double scalar, size_t count) {           \
+    for (size_t index = 0; index < count; index++) {                           \
+      into[index] = into[index] op scalar;                                     \
+    }                                                                          \
+  }
+
+PLAIN_COMBINE(plain_add, +)
+PLAIN_COMBINE(plain_subtract, -)
+PLAIN_COMBINE(plain_multiply, *)
+PLAIN_COMBINE(plain_divide, /)
+
+static double plain_sum(double const *numbers, size_t count) {
+  double sum = 0;
+  for (size_t index = 0; index < count; index++) {
+    sum += numbers[index];
+  }
+  return sum;
+}
+
+static double plain_minimum(double const *numbers, size_t count) {
+  double minimum = numbers[0];
+  for (size_t index = 1; index < count; index++) {
+    minimum = numbers[index] < minimum ? numbers[index] : minimum;
+  }
+  return minimum;
+}
+
+static double plain_maximum(double const *numbers, size_t count) {
+  double maximum = numbers[0];
+  for (size_t index = 1; index < count; index++) {
+    maximum = numbers[index] > maximum ? numbers[index] : maximum;
+  }
+  return maximum;
+}
+
+static double plain_dot(double const *left, double const *right,
+                        size_t count) {
+  double sum = 0;
+  for (size_t index = 0; index < count; index++) {
+    sum += left[index] * right[index];
+  }
+  return sum;
+}
+
+static Kernels const PLAIN = {
+    {plain_add, plain_subtract, plain_multiply, plain_divide},
+    {plain_add_by, plain_subtract_by, plain_multiply_by, plain_divide_by},
+    plain_sum,
+    plain_minimum,
+    plain_maximum,
+    plain_dot};
+
+#ifdef LYE_SIMD
+
+// =============
+// SSE2 and AVX2
+// =============
+
+/*
+ * src/vector.c:SIMD_COMBINE
+ * buildyourownlisp.com correspondence: none
+ *
+ * Define both kernels for an element-wise operation with an instruction set,
+ * given how it names a register of `WIDTH` doubles, the prefix of its
+ * intrinsics and the attribute its functions are compiled with. Numbers are
+ * loaded `WIDTH` at a time from aligned addresses, since vectors are aligned
+ * and `WIDTH` divides VECTOR_ALIGNMENT; the few left over at the end are
+ * handled one by one, as are the lanes of a register in reductions.
+ *
+ */
+#define SIMD_COMBINE(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, name, op, apply) \
+  ATTRIBUTE static void ISA##_##name(double *into, double const *from,         \
+                                     size_t count) {                           \
+    size_t index = 0;                                                          \
+    for (; index + WIDTH <= count; index += WIDTH) {                           \
+      REGISTER x = PREFIX##_load_pd(into + index);                             \
+      REGISTER y = PREFIX##_load_pd(from + index);                             \
+      PREFIX##_store_pd(into + index, PREFIX##_##apply##_pd(x, y));            \
+    }                                                                          \
+    for (; index < count; index++) {                                           \
+      into[index] = into[index] op from[index];                                \
+    }                                                                          \
+  }                                                                            \
+  ATTRIBUTE static void ISA##_##name##_by(double *into, double scalar,         \
+                                          size_t count) {                      \
+    REGISTER y = PREFIX##_set1_pd(scalar);                                     \
+    size_t index = 0;                                                          \
+    for (; index + WIDTH <= count; index += WIDTH) {                           \
+      REGISTER x = PREFIX##_load_pd(into + index);                             \
+      PREFIX##_store_pd(into + index, PREFIX##_##apply##_pd(x, y));            \
+    }                                                                          \
+    for (; index < count; index++) {                                           \
+      into[index] = into[index] op scalar;                                     \
+    }                                                                          \
+  }
+
+// Define the kernel that finds the smallest or largest number, likewise
+#define SIMD_EXTREME(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, name, apply, op) \
+  ATTRIBUTE static double ISA##_##name(double const *numbers, size_t count) {  \
+    REGISTER lanes = PREFIX##_set1_pd(numbers[0]);                             \
+    size_t index = 0;                                                          \
+    for (; index + WIDTH <= count; index += WIDTH) {                           \
+      lanes = PREFIX##_##apply##_pd(lanes, PREFIX##_load_pd(numbers + index)); \
+    }                                                                          \
+    double stored[WIDTH];                                                      \
+    PREFIX##_storeu_pd(stored, lanes);                                         \
+    double result = stored[0];                                                 \
+    for (size_t lane = 1; lane < WIDTH; lane++) {                              \
+      result = stored[lane] op result ? stored[lane] : result;                 \
+    }                                                                          \
+    for (; index < count; index++) {                                           \
+      result = numbers[index] op result ? numbers[index] : result;             \
+    }                                                                          \
+    return result;                                                             \
+  }
+
+// Define every kernel for an instruction set, and the table that holds them
+#define SIMD_KERNELS(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE)                  \
+  SIMD_COMBINE(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, add, +, add)           \
+  SIMD_COMBINE(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, subtract, -, sub)      \
+  SIMD_COMBINE(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, multiply, *, mul)      \
+  SIMD_COMBINE(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, divide, /, div)        \
+  SIMD_EXTREME(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, minimum, min, <)       \
+  SIMD_EXTREME(ISA, REGISTER, WIDTH, PREFIX, ATTRIBUTE, maximum, max, >)       \
+                                                                               \
+  ATTRIBUTE static double ISA##_sum(double const *numbers, size_t count) {     \
+    REGISTER lanes = PREFIX##_setzero_pd();                                    \
+    size_t index = 0;                                                          \
+    for (; index + WIDTH <= count; index += WIDTH) {                           \
+      lanes = PREFIX##_add_pd(lanes, PREFIX##_load_pd(numbers + index));       \
+    }                                                                          \
+    double stored[WIDTH];                                                      \
+    PREFIX##_storeu_pd(stored, lanes);                                         \
+    double sum = 0;                                                            \
+    for (size_t lane = 0; lane < WIDTH; lane++) {                              \
+      sum += stored[lane];                                                     \
+    }                                                                          \
+    for (; index < count; index++) {                                           \
+      sum += numbers[index];                                                   \
+    }                                                                          \
+    return sum;                                                                \
+  }                                                                            \
+                                                                               \
+  ATTRIBUTE static double ISA##_dot(double const *left, double const *right,   \
+                                    size_t count) {                            \
+    REGISTER lanes = PREFIX##_setzero_pd();                                    \
+    size_t index = 0;                                                          \
+    for (; index + WIDTH <= count; index += WIDTH) {                           \
+      REGISTER products = PREFIX##_mul_pd(PREFIX##_load_pd(left + index),      \
+                                          PREFIX##_load_pd(right + index));    \
+      lanes = PREFIX##_add_pd(lanes, products);                                \
+    }                                                                          \
+    double stored[WIDTH];                                                      \
+    PREFIX##_storeu_pd(stored, lanes);                                         \
+    double sum = 0;                                                            \
+    for (size_t lane = 0; lane < WIDTH; lane++) {                              \
+      sum += stored[lane];                                                     \
+    }                                                                          \
+    for (; index < count; index++) {                                           \
+      sum += left[index] * right[index];                                       \
+    }                                                                          \
+    return sum;                                                                \
+  }                                                                            \
+                                                                               \
+  static Kernels const ISA##_KERNELS = {                                       \
+      {ISA##_add, ISA##_subtract, ISA##_multiply, ISA##_divide},               \
+      {ISA##_add_by, ISA##_subtract_by, ISA##_multiply_by, ISA##_divide_by},   \
+      ISA##_sum,                                                               \
+      ISA##_minimum,                                                           \
+      ISA##_maximum,                                                           \
+      ISA##_dot};
+
+/* Every x86-64 CPU has SSE2. AVX2 kernels are compiled for it even if the rest
+of the program is not, and only used if the CPU has it */
+SIMD_KERNELS(sse2, __m128d, 2, _mm, )
+SIMD_KERNELS(avx2, __m256d, 4, _mm256, __attribute__((target("avx2"))))
+
+#undef SIMD_KERNELS
+#undef SIMD_EXTREME
+#undef SIMD_COMBINE
+
+#endif
+
+/* The kernels used on this CPU, chosen on first use */
+static Kernels const *kernels = NULL;
+
+/*
+ * src/vector.c:get_kernels
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the fastest kernels that this CPU supports.
+ *
+ */
+static Kernels const *get_kernels(void) {
+  if (!kernels) {
+    kernels = &PLAIN;
+#ifdef LYE_SIMD
+    kernels = has_avx2() ? &avx2_KERNELS : &sse2_KERNELS;
+#endif
+  }
+  return kernels;
+}
+
+// ==========
+// Arithmetic
+// ==========
+
+// Check if an argument is zero, or a vector with a zero in it
+static bool has_zero(Value *argument) {
+  if (!IS_VECTOR(argument)) {
+    return number_of(argument) == 0;
+  }
+  for (size_t index = 0; index < argument->data.vector.count; index++) {
+    if (argument->data.vector.numbers[index] == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * src/vector.c:combine_vectors
+ * buildyourownlisp.com correspondence: contained within builtin_op
+ *
+ * Apply an element-wise operation to arguments which are numbers or vectors,
+ * at least one of them a vector, from left to right. The vectors must all be
+ * of the same length, and numbers count as vectors of that length with the
+ * number in every place. A single argument is negated by subtraction, like
+ * a number would be. Callers must pass at least one vector.
+ *
+ */
+static Value *combine_vectors(Operation operation, Value **arguments,
+                              size_t count) {
+  size_t first = 0;
+  while (!IS_VECTOR(arguments[first])) {
+    first++;
+  }
+  size_t length = arguments[first]->data.vector.count;
+  for (size_t index = first + 1; index < count; index++) {
+    if (IS_VECTOR(arguments[index]) &&
+        arguments[index]->data.vector.count != length) {
+      return make_error("cannot combine vectors of lengths %zu and %zu.",
+                        length, arguments[index]->data.vector.count);
+    }
+  }
+  if (operation == DIVIDE) {
+    for (size_t index = 1; index < count; index++) {
+      if (has_zero(arguments[index])) {
+        return make_error("cannot divide by zero.");
+      }
+    }
+  }
+
+  Value *result = make_vector(length);
+  double *numbers = result->data.vector.numbers;
+  if (IS_VECTOR(arguments[0])) {
+    if (length > 0) {
+      memcpy(numbers, arguments[0]->data.vector.numbers,
+             sizeof(double) * length);
+    }
+  } else {
+    for (size_t index = 0; index < length; index++) {
+      numbers[index] = number_of(arguments[0]);
+    }
+  }
+
+  Kernels const *selected = get_kernels();
+  if (operation == SUBTRACT && count == 1) {
+    selected->combine_by[MULTIPLY](numbers, -1, length);
+  }
+  for (size_t index = 1; index < count; index++) {
+    Value *argument = arguments[index];
+    if (IS_VECTOR(argument)) {
+      selected->combine[operation](numbers, argument->data.vector.numbers,
+                                   length);
+    } else {
+      selected->combine_by[operation](numbers, number_of(argument), length);
+    }
+  }
+  return result;
+}
+
+Value *add_vectors(Value **arguments, size_t count) {
+  return combine_vectors(ADD, arguments, count);
+}
+
+Value *subtract_vectors(Value **arguments, size_t count) {
+  return combine_vectors(SUBTRACT, arguments, count);
+}
+
+Value *multiply_vectors(Value **arguments, size_t count) {
+  return combine_vectors(MULTIPLY, arguments, count);
+}
+
+Value *divide_vectors(Value **arguments, size_t count) {
+  return combine_vectors(DIVIDE, arguments, count);
+}
+
+/*
+ * src/vector.c:find_extreme
+ * buildyourownlisp.com correspondence: none
+ *
+ * Return the smallest (or largest) of all the numbers given, whether on their
+ * own or in vectors. Which one that is, if any of them is NaN, is left
+ * unspecified.
+ *
+ */
+static Value *find_extreme(Value **arguments, size_t count, bool is_minimum) {
+  Kernels const *selected = get_kernels();
+  bool is_found = false;
+  double extreme = 0;
+
+  for (size_t index = 0; index < count; index++) {
+    Value *argument = arguments[index];
+    double candidate;
+    if (!IS_VECTOR(argument)) {
+      candidate = number_of(argument);
+    } else if (argument->data.vector.count == 0) {
+      continue;
+    } else {
+      candidate = (is_minimum ? selected->minimum : selected->maximum)(
+          argument->data.vector.numbers, argument->data.vector.count);
+    }
+
+    if (!is_found) {
+      extreme = candidate;
+      is_found = true;
+    } else {
+      extreme =
+          is_minimum ? fmin(extreme, candidate) : fmax(extreme, candidate);
+    }
+  }
+
+  if (!is_found) {
+    return make_error(BASE_FORMAT, is_minimum ? "min" : "max",
+                      "at least one number.");
+  }
+  return make_number(extreme);
+}
+
+Value *min_vectors(Value **arguments, size_t count) {
+  return find_extreme(arguments, count, true);
+}
+
+Value *max_vectors(Value **arguments, size_t count) {
+  return find_extreme(arguments, count, false);
+}
+
+// ========
+// Builtins
+// ========
+
+/*
+ * src/vector.c:builtin_to_vector
+ * buildyourownlisp.com correspondence: none
+ *
+ * Take a list of numbers and return a vector of the same numbers.
+ *
+ */
+Value *builtin_to_vector(__attribute__((unused)) Env *env, Value *value) {
+  ASSERT_ARGC(value, 1, "to-vector");
+  ASSERT_IS_LIST(value, 0, "to-vector");
+
+  Value *list = element_at(value, 0);
+  size_t length = count(list);
+  for (size_t index = 0; index < length; index++) {
+    ASSERT(value, IS_NUMBER(element_at(list, index)), BASE_FORMAT,
+           "to-vector", "a list of numbers.")
+  }
+
+  Value *vector = make_vector(length);
+  for (size_t index = 0; index < length; index++) {
+    vector->data.vector.numbers[index] = number_of(element_at(list, index));
+  }
+  delete_value(value);
+  return vector;
+}
+
+/*
+ * src/vector.c:builtin_to_list
+ * buildyourownlisp.com correspondence: none
+ *
+ * Take a vector and return a list of the same numbers.
+ *
+ */
+Value *builtin_to_list(__attribute__((unused)) Env *env, Value *value) {
+  ASSERT_ARGC(value, 1, "to-list");
+  ASSERT_IS_VECTOR(value, 0, "to-list");
+
+  Vector *vector = &element_at(value, 0)->data.vector;
+  Value *list = make_qexpr();
+  if (vector->count > 0) {
+    reserve_elements(list, vector->count);
+    for (size_t index = 0; index < vector->count; index++) {
+      list->data.sexpr.cell[index] = make_number(vector->numbers[index]);
+    }
+    list->data.sexpr.count = vector->count;
+  }
+  delete_value(value);
+  return list;
+}
+
+/*
+ * src/vector.c:builtin_sum
+ * buildyourownlisp.com correspondence: none
+ *
+ * Take a vector and return the sum of its numbers.
+ *
+ */
+Value *builtin_sum(__attribute__((unused)) Env *env, Value *value) {
+  ASSERT_ARGC(value, 1, "sum");
+  ASSERT_IS_VECTOR(value, 0, "sum");
+
+  Vector *vector = &element_at(value, 0)->data.vector;
+  Value *result =
+      make_number(get_kernels()->sum(vector->numbers, vector->count));
+  delete_value(value);
+  return result;
+}
+
+/*
+ * src/vector.c:builtin_dot
+ * buildyourownlisp.com correspondence: none
+ *
+ * Take two vectors of the same length and return their dot product: the sum
+ * of the products of their matching numbers.
+ *
+ */
+Value *builtin_dot(__attribute__((unused)) Env *env, Value *value) {
+  ASSERT_ARGC(value, 2, "dot");
+  ASSERT_IS_VECTOR(value, 0, "dot");
+  ASSERT_IS_VECTOR(value, 1, "dot");
+
+  Vector *left = &element_at(value, 0)->data.vector;
+  Vector *right = &element_at(value, 1)->data.vector;
+  ASSERT(value, left->count == right->count,
+         "cannot combine vectors of lengths %zu and %zu.", left->count,
+         right->count)
+
+  Value *result = make_number(
+      get_kernels()->dot(left->numbers, right->numbers, left->count));
+  delete_value(value);
+  return result;
+}
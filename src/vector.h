@@ -0,0 +1,35 @@
+/*
+ * src/vector.h
+ *
+ * Contain built-in Lye functions that work on vectors: Values that hold any
+ * number of numbers side by side in a single array, rather than as a list of
+ * separate Values. Vectors are made from lists of numbers with `to-vector`,
+ * and the arithmetic operators, `min` and `max` take them as well as numbers.
+ *
+ * Numbers are handled many at a time: 4 per instruction with AVX2, when the
+ * CPU running the program has it, or 2 with SSE2. Other machines, and builds
+ * with -DLYE_NO_SIMD, handle them one by one. Sums may therefore be rounded
+ * differently from adding the same numbers up in order.
+ *
+ */
+#ifndef lye_vector_h
+#define lye_vector_h
+
+#include "assert.h"
+#include "simd.h"
+#include "value.h"
+
+/* Kernels for arithmetic whose arguments include vectors (see calc.c) */
+Value *add_vectors(Value **arguments, size_t count);
+Value *subtract_vectors(Value **arguments, size_t count);
+Value *multiply_vectors(Value **arguments, size_t count);
+Value *divide_vectors(Value **arguments, size_t count);
+Value *min_vectors(Value **arguments, size_t count);
+Value *max_vectors(Value **arguments, size_t count);
+
+Value *builtin_to_vector(Env *env, Value *value);
+Value *builtin_to_list(Env *env, Value *value);
+Value *builtin_sum(Env *env, Value *value);
+Value *builtin_dot(Env *env, Value *value);
+
+#endif
@@ -0,0 +1,350 @@
+#include "vm.h"
+
+#include "env.h"
+
+/* Define a call in progress. `fun` is the lambda being called, which owns
+`env` (and `code`, unless `expression` is set); it is NULL if `env` belongs to
+someone else, such as the caller of `run`. `expression` is set when the frame
+runs an S-expression passed to `eval`, compiled into `code`, which it owns */
+typedef struct Frame {
+  Env *env;
+  Code *code;
+  size_t pc;
+  Value *fun;
+  Value *expression;
+} Frame;
+
+/* The stacks are shared by nested runs (e.g. from `eval`), each of which only
+uses what is above where the stacks were when it started. Since they may be
+reallocated by any builtin, they are always accessed by index */
+static Value **stack = NULL;
+static size_t stack_count = 0;
+static size_t stack_capacity = 0;
+
+static Frame *frames = NULL;
+static size_t frame_count = 0;
+static size_t frame_capacity = 0;
+
+/* How many frames may be on the stack at once */
+static size_t max_depth = LYE_MAX_DEPTH;
+
+/*
+ * src/vm.c:configure_vm
+ * buildyourownlisp.com correspondence: none
+ *
+ * Read the maximum call depth from the environment variable LYE_MAX_DEPTH,
+ * keeping the default if it is missing or invalid.
+ *
+ */
+void configure_vm(void) {
+  char *setting = getenv("LYE_MAX_DEPTH");
+  char *end;
+
+  if (setting) {
+    unsigned long depth = strtoul(setting, &end, 10);
+    if (*end == '\0' && depth > 0) {
+      max_depth = depth;
+    }
+  }
+}
+
+// Push a Value on the stack
+static inline void push(Value *value) {
+  if (stack_count == stack_capacity) {
+    stack_capacity = stack_capacity ? stack_capacity * 2 : 256;
+    stack = realloc(stack, sizeof(Value *) * stack_capacity);
+  }
+  stack[stack_count++] = value;
+}
+
+// Start running a piece of Code
+static inline void push_frame(Env *env, Code *code, Value *fun,
+                              Value *expression) {
+  if (frame_count == frame_capacity) {
+    frame_capacity = frame_capacity ? frame_capacity * 2 : 64;
+    frames = realloc(frames, sizeof(Frame) * frame_capacity);
+  }
+  frames[frame_count++] = (Frame){env, code, 0, fun, expression};
+}
+
+// Make the error for a call that would go deeper than allowed
+static inline Value *too_deep(void) {
+  return make_error("Maximum call depth of %lu exceeded.",
+                    (unsigned long)max_depth);
+}
+
+// Drop what a frame owns, once it is done running
+static inline void finish_frame(Frame *frame) {
+  if (frame->fun) {
+    delete_value(frame->fun);
+  }
+  if (frame->expression) {
+    delete_code(frame->code);
+    delete_value(frame->expression);
+  }
+}
+
+// Check if the instruction being run is the last one of its frame's Code
+static inline bool is_tail(Frame *frame) {
+  return frame->code->instructions[frame->pc].opcode == OP_RETURN;
+}
+
+// We need to treat `print-env` different from other singleton values
+static inline bool is_singleton(Value *first) {
+  return !IS_FUNCTION(first) || (first->data.function->builtin &&
+                                 first->data.function->builtin !=
+                                     builtin_print_env);
+}
+
+/*
+ * src/vm.c:collect_arguments
+ * buildyourownlisp.com correspondence: none
+ *
+ * Move the Values above the given position of the stack into a new
+ * S-expression, to be passed as arguments to a function.
+ *
+ */
+static Value *collect_arguments(size_t base) {
+  Value *args = make_sexpr();
+  size_t length = stack_count - base;
+  if (length > 0) {
+    reserve_elements(args, length);
+    memcpy(args->data.sexpr.cell, &stack[base], sizeof(Value *) * length);
+    args->data.sexpr.count = length;
+  }
+  stack_count = base;
+  return args;
+}
+
+/*
+ * src/vm.c:unwind
+ * buildyourownlisp.com correspondence: none
+ *
+ * Abandon a run because of an error, dropping everything it left on the
+ * stacks, and return the error.
+ *
+ */
+static Value *unwind(size_t stack_base, size_t frame_base, Value *error) {
+  while (stack_count > stack_base) {
+    delete_value(stack[--stack_count]);
+  }
+  while (frame_count > frame_base) {
+    finish_frame(&frames[--frame_count]);
+  }
+  return error;
+}
+
+/* Instruction dispatch: either a jump through a table of label addresses, or
+a plain switch in a loop. The first is an extension of GNU C */
+#ifdef LYE_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define CASE(opcode) label_##opcode:
+#define NEXT()                                                                 \
+  do {                                                                         \
+    frame = &frames[frame_count - 1];                                          \
+    instruction = &frame->code->instructions[frame->pc++];                     \
+    goto *labels[instruction->opcode];                                         \
+  } while (0)
+#else
+#define CASE(opcode) case opcode:
+#define NEXT() continue
+#endif
+
+/*
+ * src/vm.c:run
+ * buildyourownlisp.com correspondence: lval_eval
+ *
+ * Run a piece of Code in the given Env, and return the resulting Value.
+ *
+ * Calls in tail position, whose value is the value of the whole frame, reuse
+ * the frame instead of pushing a new one, so that tail-recursive loops run in
+ * constant space. This includes `eval`, whose S-expression is run by the VM
+ * itself. A lambda's Env has its caller's Env as parent, which is why a tail
+ * call can only drop the caller's frame if the callee's Env shadows all of
+ * the caller's: then the caller's Env can be spliced out of the chain.
+ *
+ */
+Value *run(Env *env, Code *code) {
+  size_t stack_base = stack_count;
+  size_t frame_base = frame_count;
+  Frame *frame;
+  Instruction *instruction;
+  /* The function being applied and its arguments, shared by the cases that
+  apply functions */
+  Value *fun;
+  Value *args;
+
+  push_frame(env, code, NULL, NULL);
+
+#ifdef LYE_COMPUTED_GOTO
+  static void *labels[] = {&&label_OP_PUSH,  &&label_OP_EMPTY,
+                           &&label_OP_LOAD,  &&label_OP_APPLY,
+                           &&label_OP_BUILTIN, &&label_OP_RETURN};
+  NEXT();
+#else
+  for (;;) {
+    frame = &frames[frame_count - 1];
+    instruction = &frame->code->instructions[frame->pc++];
+    switch ((Opcode)instruction->opcode) {
+#endif
+
+  CASE(OP_PUSH) {
+    Value *value = instruction->operand.value;
+    if (IS_ERROR(value)) {
+      return unwind(stack_base, frame_base, copy_value(value));
+    }
+    push(copy_value(value));
+    NEXT();
+  }
+
+  CASE(OP_EMPTY) {
+    push(make_sexpr());
+    NEXT();
+  }
+
+  CASE(OP_LOAD) {
+    Value *value = get_value(frame->env, instruction->operand.value);
+    if (IS_ERROR(value)) {
+      return unwind(stack_base, frame_base, value);
+    }
+    push(value);
+    NEXT();
+  }
+
+  CASE(OP_BUILTIN) {
+    size_t base = stack_count - instruction->count;
+    fun = stack[base];
+    /* Unless the name was rebound, skip straight to the builtin */
+    if (!IS_FUNCTION(fun) ||
+        fun->data.function->builtin != instruction->operand.builtin) {
+      goto apply;
+    }
+    args = collect_arguments(base + 1);
+    stack_count = base;
+    goto call_builtin;
+  }
+
+  CASE(OP_APPLY) {
+  apply:;
+    size_t base = stack_count - instruction->count;
+    fun = stack[base];
+
+    /* Singleton expression: the value stays where it is */
+    if (instruction->count == 1 && is_singleton(fun)) {
+      NEXT();
+    }
+
+    /* Ensure first element is a function after evaluation */
+    if (!IS_FUNCTION(fun)) {
+      return unwind(
+          stack_base, frame_base,
+          make_error("S-expression must start with a function, found type %s.",
+                     get_type(fun)));
+    }
+
+    args = collect_arguments(base + 1);
+    stack_count = base;
+
+    /* If the function is a builtin we simply call that */
+    if (fun->data.function->builtin) {
+    call_builtin:
+      if (fun->data.function->builtin == builtin_eval && count(args) == 1 &&
+          IS_QEXPR(element_at(args, 0))) {
+        goto call_eval;
+      }
+      Value *result = fun->data.function->builtin(frame->env, args);
+      delete_value(fun);
+      if (IS_ERROR(result)) {
+        return unwind(stack_base, frame_base, result);
+      }
+      push(result);
+      NEXT();
+    }
+
+    /* Otherwise bind the arguments, and run the body if there are enough of
+    them; the frame keeps the function until the body returns */
+    bool is_complete;
+    fun = bind_arguments(fun, args, &is_complete);
+    if (IS_ERROR(fun)) {
+      return unwind(stack_base, frame_base, fun);
+    }
+    if (!is_complete) {
+      push(fun);
+      NEXT();
+    }
+
+    Env *callee = fun->data.function->env;
+    if (is_tail(frame) && frame->fun && shadows_env(callee, frame->env)) {
+      callee->parent = frame->env->parent;
+      finish_frame(frame);
+      *frame = (Frame){callee, fun->data.function->code, 0, fun, NULL};
+    } else {
+      if (frame_count == max_depth) {
+        delete_value(fun);
+        return unwind(stack_base, frame_base, too_deep());
+      }
+      callee->parent = frame->env;
+      push_frame(callee, fun->data.function->code, fun, NULL);
+    }
+    NEXT();
+
+  call_eval:;
+    /* Run the S-expression in the current Env, like `builtin_eval` would */
+    Value *expression = unshare_value(take_value(args, 0));
+    expression->type = SEXPR;
+    delete_value(fun);
+    if (is_tail(frame)) {
+      if (frame->expression) {
+        delete_code(frame->code);
+        delete_value(frame->expression);
+      }
+      frame->code = compile(expression);
+      frame->pc = 0;
+      frame->expression = expression;
+    } else {
+      if (frame_count == max_depth) {
+        delete_value(expression);
+        return unwind(stack_base, frame_base, too_deep());
+      }
+      push_frame(frame->env, compile(expression), NULL, expression);
+    }
+    NEXT();
+  }
+
+  CASE(OP_RETURN) {
+    Value *result = stack[--stack_count];
+    finish_frame(frame);
+    frame_count--;
+    if (frame_count == frame_base) {
+      return result;
+    }
+    push(result);
+    NEXT();
+  }
+
+#ifndef LYE_COMPUTED_GOTO
+    }
+  }
+#endif
+}
+
+#ifdef LYE_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+/*
+ * src/vm.c:release_vm
+ * buildyourownlisp.com correspondence: none
+ *
+ * Free the memory used by the VM's stacks, at the end of the program.
+ *
+ */
+void release_vm(void) {
+  free(stack);
+  free(frames);
+  stack = NULL;
+  frames = NULL;
+  stack_capacity = 0;
+  frame_capacity = 0;
+}
@@ -0,0 +1,36 @@
+/*
+ * src/vm.h
+ *
+ * Define the virtual machine that runs compiled Code (see compiler.h). It is a
+ * stack machine: each instruction pushes a Value on the stack, or replaces
+ * some of the Values on top of it with another one. Calls to lambdas do not
+ * recurse in C: the VM keeps a stack of frames, one per call in progress.
+ *
+ * An error stops the whole run, since in Lye an error anywhere becomes the
+ * value of every expression around it.
+ *
+ */
+#ifndef lye_vm_h
+#define lye_vm_h
+
+#include "compiler.h"
+#include "value.h"
+
+/* Dispatch instructions with computed gotos where the compiler supports them,
+unless -DLYE_NO_COMPUTED_GOTO is given */
+#if defined(__GNUC__) && !defined(LYE_NO_COMPUTED_GOTO)
+#define LYE_COMPUTED_GOTO
+#endif
+
+/* Default for the maximum number of calls in progress at once, which may also
+be set at runtime from the environment variable of the same name. Going deeper
+is an error, rather than a crash */
+#ifndef LYE_MAX_DEPTH
+#define LYE_MAX_DEPTH 1000000
+#endif
+
+void configure_vm(void);
+Value *run(Env *env, Code *code);
+void release_vm(void);
+
+#endif
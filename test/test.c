@@ -26,16 +26,20 @@ static inline bool is_test(char *path) {
   return !strcmp(extension, ".lye");
 }
 
-static void build_command(char *source, char *result) {
-  char *lye = "./lye";
-  size_t command_length = strlen(lye) + strlen(source) + 7;
-  char concat[command_length];
-  memset(concat, 0, command_length);
-  strcat(concat, lye);
-  strcat(concat, " -s \"");
-  strcat(concat, source);
-  strcat(concat, "\"");
-  strcpy(result, concat);
+// Tests in a file are run with -s, unless a line like this one names a command
+// that the tests below it are to be piped into instead
+#define RUN_DIRECTIVE "; Run: "
+
+static char *build_command(char *source, char *runner) {
+  char *command;
+  if (runner == NULL) {
+    asprintf(&command, "./lye -s \"%s\"", source);
+  } else {
+    // Only the last line printed by the runner is the result
+    asprintf(&command, "printf '%%s\\n' \"%s\" | %s | tail -n 1", source,
+             runner);
+  }
+  return command;
 }
 
 static char *get_expected(char *line) {
@@ -59,7 +63,7 @@ static inline char *get_result(char *tmp_file) {
 }
 
 static void run_test(char *line, uint16_t line_number, char *test_filename,
-                     char *result_filename) {
+                     char *result_filename, char *runner) {
   // Read the test from the test line
   size_t semicolon_position = strcspn(line, ";");
 
@@ -75,12 +79,9 @@ static void run_test(char *line, uint16_t line_number, char *test_filename,
     freopen(result_filename, "w+", stdout);
 
     // Run the test, leaving the result in the temporary file
-    char command[100];
-    build_command(line, command);
+    char *command = build_command(line, runner);
     system(command);
-
-    // Reset the Lye command for the next test run
-    command[0] = '\0';
+    free(command);
 
     // Read the actual result from the temporary file
     char *result = get_result(result_filename);
@@ -108,6 +109,7 @@ static void run_test_file(char *test_filename, char *result_filename) {
   }
 
   char *line = NULL;
+  char *runner = NULL;
   size_t length = 0;
   uint16_t line_number = 0;
 
@@ -117,11 +119,19 @@ static void run_test_file(char *test_filename, char *result_filename) {
       continue;
     }
 
-    run_test(line, line_number, test_filename, result_filename);
+    if (strncmp(line, RUN_DIRECTIVE, strlen(RUN_DIRECTIVE)) == 0) {
+      free(runner);
+      runner = strdup(line + strlen(RUN_DIRECTIVE));
+      runner[strcspn(runner, "\n")] = '\0';
+      continue;
+    }
+
+    run_test(line, line_number, test_filename, result_filename, runner);
   }
 
   // Clean up
   fclose(test_file);
+  free(runner);
   if (line) {
     free(line);
   }
@@ -1,7 +1,11 @@
 #define _GNU_SOURCE
 
 #include <err.h>
+#include <fcntl.h>
 #include <fts.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "file.h"
 
@@ -62,3 +66,90 @@ char *read_file(const char *path) {
   fclose(file);
   return buffer;
 }
+
+/* Read everything left in an open file, whose size is not known in advance,
+into a new buffer. Return false if reading failed */
+static bool read_descriptor(int descriptor, MappedFile *mapped) {
+  size_t capacity = 4096;
+  char *text = malloc(capacity);
+  size_t size = 0;
+
+  for (;;) {
+    if (size == capacity) {
+      capacity *= 2;
+      text = realloc(text, capacity);
+    }
+    ssize_t bytes_read = read(descriptor, text + size, capacity - size);
+    if (bytes_read == 0) {
+      break;
+    }
+    if (bytes_read == -1) {
+      free(text);
+      return false;
+    }
+    size += (size_t)bytes_read;
+  }
+
+  mapped->text = text;
+  mapped->size = size;
+  mapped->is_mapped = false;
+  return true;
+}
+
+/* Given a filename, map its contents into memory, read-only, and tell the
+kernel they will be read from start to end. Unlike `read_file`, the text is not
+copied, and it is not null-terminated: use `mapped->size`. Anything other than a
+regular file, such as a pipe, has no size to map, so it is read into memory */
+bool map_file(const char *path, MappedFile *mapped) {
+  int descriptor = open(path, O_RDONLY);
+  if (descriptor == -1) {
+    fprintf(stderr, "Could not open file \"%s\".\n", path);
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(descriptor, &status) == -1) {
+    fprintf(stderr, "Could not determine size of file \"%s\".\n", path);
+    close(descriptor);
+    return false;
+  }
+
+  if (!S_ISREG(status.st_mode)) {
+    bool success = read_descriptor(descriptor, mapped);
+    close(descriptor);
+    if (!success) {
+      fprintf(stderr, "Could not read file \"%s\".\n", path);
+    }
+    return success;
+  }
+
+  mapped->size = (size_t)status.st_size;
+  mapped->is_mapped = true;
+
+  /* An empty file cannot be mapped, but there is nothing to read anyway */
+  if (mapped->size == 0) {
+    mapped->text = "";
+    close(descriptor);
+    return true;
+  }
+
+  void *text = mmap(NULL, mapped->size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor);
+  if (text == MAP_FAILED) {
+    fprintf(stderr, "Could not map file \"%s\".\n", path);
+    return false;
+  }
+  madvise(text, mapped->size, MADV_SEQUENTIAL);
+
+  mapped->text = text;
+  return true;
+}
+
+/* Undo `map_file` */
+void unmap_file(MappedFile *mapped) {
+  if (!mapped->is_mapped) {
+    free((void *)mapped->text);
+  } else if (mapped->size > 0) {
+    munmap((void *)mapped->text, mapped->size);
+  }
+}
@@ -1,15 +1,27 @@
 /*
  * utils/file.h
  *
- * Expose a utility function to read a file into a string.
+ * Expose utility functions to read a file into a string, or to map it into
+ * memory.
  *
  */
 #ifndef utils_file_h
 #define utils_file_h
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+/* Define a file mapped into memory by `map_file`. Files that cannot be mapped,
+such as pipes, are copied instead, and `is_mapped` is false */
+typedef struct MappedFile {
+  char const *text;
+  size_t size;
+  bool is_mapped;
+} MappedFile;
+
 char *read_file(const char *path);
+bool map_file(const char *path, MappedFile *mapped);
+void unmap_file(MappedFile *mapped);
 
 #endif
@@ -0,0 +1,104 @@
+#include <stdarg.h>
+#include <string.h>
+
+#include "string_builder.h"
+
+/* How much is buffered before being written, when writing to a file */
+#define FILE_BUFFER 65536
+
+/* Get a StringBuilder ready for use. If `file` is NULL, the string is kept
+in memory until `finish_builder` hands it over; otherwise it is written to
+the file as it goes. */
+void start_builder(StringBuilder *builder, FILE *file) {
+  builder->file = file;
+  builder->length = 0;
+  builder->capacity = file ? FILE_BUFFER : 64;
+  builder->text = malloc(builder->capacity);
+  builder->text[0] = '\0';
+}
+
+/* Write out whatever a StringBuilder has buffered for its file */
+static void flush(StringBuilder *builder) {
+  fwrite(builder->text, 1, builder->length, builder->file);
+  builder->length = 0;
+}
+
+/* Make room for `length` more characters, plus the null terminator, either
+by writing the buffer out or by growing it geometrically. */
+static void reserve(StringBuilder *builder, size_t length) {
+  if (builder->length + length < builder->capacity) {
+    return;
+  }
+  if (builder->file) {
+    flush(builder);
+  }
+  while (builder->length + length >= builder->capacity) {
+    builder->capacity *= 2;
+  }
+  builder->text = realloc(builder->text, builder->capacity);
+}
+
+/* Append the given number of characters to a StringBuilder */
+void append_chars(StringBuilder *builder, char const *chars, size_t length) {
+  reserve(builder, length);
+  memcpy(builder->text + builder->length, chars, length);
+  builder->length += length;
+  builder->text[builder->length] = '\0';
+}
+
+/* Append a null-terminated string to a StringBuilder */
+void append_string(StringBuilder *builder, char const *string) {
+  append_chars(builder, string, strlen(string));
+}
+
+/* Append a single character to a StringBuilder */
+void append_char(StringBuilder *builder, char character) {
+  reserve(builder, 1);
+  builder->text[builder->length++] = character;
+  builder->text[builder->length] = '\0';
+}
+
+/* Make room for `length` more characters, and return where they go. They are
+only part of the string once `commit_chars` says how many were written */
+char *reserve_chars(StringBuilder *builder, size_t length) {
+  reserve(builder, length);
+  return builder->text + builder->length;
+}
+
+/* Add to the string the characters written where `reserve_chars` said */
+void commit_chars(StringBuilder *builder, size_t length) {
+  builder->length += length;
+  builder->text[builder->length] = '\0';
+}
+
+/* Append a string to a StringBuilder, formatted like `printf` does. It is
+formatted straight into the buffer, which only grows if it is too short. */
+void append_format(StringBuilder *builder, char const *format, ...) {
+  va_list pieces;
+  va_start(pieces, format);
+  size_t room = builder->capacity - builder->length;
+  int length = vsnprintf(builder->text + builder->length, room, format, pieces);
+  va_end(pieces);
+
+  if (length >= 0 && (size_t)length >= room) {
+    reserve(builder, (size_t)length);
+    va_start(pieces, format);
+    vsnprintf(builder->text + builder->length, (size_t)length + 1, format,
+              pieces);
+    va_end(pieces);
+  }
+  if (length > 0) {
+    builder->length += (size_t)length;
+  }
+}
+
+/* Return the string that was built, which the caller must free; or, when
+writing to a file, write out the rest of it and return NULL. */
+char *finish_builder(StringBuilder *builder) {
+  if (builder->file) {
+    flush(builder);
+    free(builder->text);
+    builder->text = NULL;
+  }
+  return builder->text;
+}
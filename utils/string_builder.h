@@ -0,0 +1,35 @@
+/*
+ * utils/string_builder.h
+ *
+ * Expose a StringBuilder, which puts a string together piece by piece. It
+ * either keeps the whole string in memory, growing it geometrically, or writes
+ * it out to a file whenever its buffer fills up, so that arbitrarily long
+ * output takes a fixed amount of memory.
+ *
+ */
+#ifndef utils_string_builder_h
+#define utils_string_builder_h
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Define a string being built. If `file` is not NULL, `text` is only a buffer
+for what has not been written to it yet */
+typedef struct StringBuilder {
+  char *text;
+  size_t length;
+  size_t capacity;
+  FILE *file;
+} StringBuilder;
+
+void start_builder(StringBuilder *builder, FILE *file);
+void append_chars(StringBuilder *builder, char const *chars, size_t length);
+void append_string(StringBuilder *builder, char const *string);
+void append_char(StringBuilder *builder, char character);
+char *reserve_chars(StringBuilder *builder, size_t length);
+void commit_chars(StringBuilder *builder, size_t length);
+void append_format(StringBuilder *builder, char const *format, ...)
+    __attribute__((format(printf, 2, 3)));
+char *finish_builder(StringBuilder *builder);
+
+#endif